@@ -0,0 +1,140 @@
+// Benchmark suite, printed as JSON on stdout. The runs section, in this
+// file, gives runSimulation throughput, memory per stored step, saveResults
+// throughput, getXAtTime latency, lossless compression ratio and speed, lossy
+// ratio at tolerance 1e-3 and plotting latency for run lengths from 10^3
+// steps up to a maximum. The other sections follow in this order, each
+// described in its file: sweep and huge_pages (bench_memory.cpp), precision
+// (bench_models.cpp), ensemble (bench_ensemble.cpp), writer
+// (bench_output.cpp), models and delay (bench_models.cpp), sde
+// (bench_ensemble.cpp).
+//
+//   cmake -S . -B build && cmake --build build --target bench
+//   build/bench [maxSteps] [--save-max N] [--scan-steps N] [--plot]
+//
+// maxSteps defaults to 10^7; every stored step costs about 32 bytes, so
+// 10^9 steps needs over 32 GB of memory. saveResults is timed up to
+// --save-max steps (default 10^6), which also caps the writer section.
+// Plotting is timed only with --plot, which needs gnuplot; output goes to
+// the "unknown" terminal. --scan-steps sets the run of the huge_pages section:
+// the default of 10^7 steps (320 MB) keeps the bench short; pass
+// --scan-steps 100000000 (3.2 GB) for the long runs huge pages are meant for.
+#include "bench.hpp"
+#include "header.hpp"
+#include "compressed.hpp"
+#include "lossy.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    long maxSteps = 10000000;
+    long saveMax = 1000000;
+    long scanSteps = 10000000;
+    bool plot = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--plot") {
+            plot = true;
+        }
+        else if (arg == "--save-max" && i + 1 < argc) {
+            saveMax = std::atol(argv[++i]);
+        }
+        else if (arg == "--scan-steps" && i + 1 < argc) {
+            scanSteps = std::atol(argv[++i]);
+        }
+        else {
+            maxSteps = std::atol(argv[i]);
+        }
+    }
+    if (plot) {
+        setenv("GNUTERM", "unknown", 1);
+    }
+
+    const double deltat = 0.001;
+    const char* scratch = "bench_results.csv";
+    std::mt19937 rng(42);
+
+    std::cout << "{\n  \"deltat\": " << deltat << ",\n  \"runs\": [";
+    bool first = true;
+    for (long steps = 1000; steps <= maxSteps; steps *= 10) {
+        Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, deltat);
+        Clock::time_point start = Clock::now();
+        sim.runSimulation(steps * deltat + deltat / 2);
+        double runTime = seconds(start);
+
+        size_t stored = sim.getXValues().size();
+        double bytes = 8.0 * (sim.getXValues().capacity() + sim.getYValues().capacity() +
+                              sim.getHValues().capacity() + sim.getTimeValues().capacity());
+
+        // random queries over the whole run
+        const long queries = 1000000;
+        std::uniform_real_distribution<double> when(0, steps * deltat);
+        double sink = 0;
+        start = Clock::now();
+        for (long q = 0; q < queries; ++q) {
+            sink += sim.getXAtTime(when(rng));
+        }
+        double queryTime = seconds(start);
+
+        start = Clock::now();
+        CompressedTrajectory compressed(sim);
+        double encodeTime = seconds(start);
+        std::vector<double> decoded;
+        start = Clock::now();
+        compressed.getXSeries().decode(decoded);
+        compressed.getYSeries().decode(decoded);
+        compressed.getHSeries().decode(decoded);
+        double decodeTime = seconds(start);
+        start = Clock::now();
+        for (long q = 0; q < queries; ++q) {
+            sink += compressed.getXAtTime(when(rng));
+        }
+        double compressedQueryTime = seconds(start);
+        double raw = 3.0 * sizeof(double) * stored;
+        LossyTrajectory lossy(1e-3, 0, deltat);
+        for (size_t i = 0; i < stored; ++i) {
+            lossy.append(sim.getXValues()[i], sim.getYValues()[i], sim.getHValues()[i]);
+        }
+
+        std::cout << (first ? "\n" : ",\n") << "    {\"steps\": " << steps
+                  << ", \"steps_per_second\": " << steps / runTime
+                  << ", \"bytes_per_step\": " << bytes / stored
+                  << ", \"query_ns\": " << 1e9 * queryTime / queries
+                  << ", \"compression_ratio\": " << raw / compressed.compressedBytes()
+                  << ", \"encode_mb_per_second\": " << raw / encodeTime / 1e6
+                  << ", \"decode_mb_per_second\": " << raw / decodeTime / 1e6
+                  << ", \"compressed_query_ns\": " << 1e9 * compressedQueryTime / queries
+                  << ", \"lossy_1e-3_ratio\": " << raw / lossy.compressedBytes();
+
+        if (steps <= saveMax) {
+            start = Clock::now();
+            sim.saveResults(scratch);
+            double saveTime = seconds(start);
+            std::cout << ", \"save_mb_per_second\": " << fileSize(scratch) / saveTime / 1e6;
+            std::remove(scratch);
+        }
+        if (plot) {
+            start = Clock::now();
+            sim.plotResultsWithGnuplot();
+            sim.plotHWithGnuplot();
+            std::cout << ", \"plot_ms\": " << 1e3 * seconds(start);
+        }
+        std::cout << ", \"checksum\": " << sink / queries << "}";
+        first = false;
+    }
+    std::cout << "\n  ]";
+
+    printSweep();
+    printHugePages(scanSteps);
+    printPrecision();
+    printEnsemble(deltat);
+    printWriter(saveMax < 1000000 ? saveMax : 1000000);
+    printModels();
+    printDelay();
+    printSde(deltat);
+    std::cout << "\n}" << std::endl;
+    return 0;
+}
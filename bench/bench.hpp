@@ -0,0 +1,43 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstdio>
+
+// Shared by the files of the bench program. Each print function writes one
+// member of the top-level JSON object, starting with the comma before it.
+
+typedef std::chrono::steady_clock Clock;
+
+inline double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+inline long fileSize(const char* filename) {
+    FILE* file = std::fopen(filename, "rb");
+    if (!file) {
+        return 0;
+    }
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fclose(file);
+    return size;
+}
+
+// bench_memory.cpp
+void printSweep();
+void printHugePages(long steps);
+
+// bench_models.cpp
+void printPrecision();
+void printModels();
+void printDelay();
+
+// bench_ensemble.cpp
+void printEnsemble(double deltat);
+void printSde(double deltat);
+
+// bench_output.cpp
+void printWriter(long steps);
+
+#endif // BENCH_HPP
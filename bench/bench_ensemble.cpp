@@ -0,0 +1,89 @@
+// Ensemble sections of the bench, both over the same 4096 members. ensemble
+// steps them in double, float and mixed precision. sde steps them with
+// Euler-Maruyama and Milstein noise against the deterministic double
+// ensemble, and times Philox normal variates against std::normal_distribution
+// over mt19937_64.
+#include "bench.hpp"
+#include "ensemble.hpp"
+#include "stochastic.hpp"
+#include "philox.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<EnsembleMember> benchMembers() {
+    std::vector<EnsembleMember> members;
+    for (int i = 0; i < 4096; ++i) {
+        EnsembleMember m = { 1200.0, 1000.0, 1.5 + 0.0002 * i, 0.02, 0.01, 1.0 };
+        members.push_back(m);
+    }
+    return members;
+}
+
+}
+
+void printEnsemble(double deltat) {
+    std::vector<EnsembleMember> members = benchMembers();
+    const long ensembleSteps = 20000;
+    const char* names[] = { "double", "float", "mixed" };
+    Ensemble exact(members, deltat, EnsembleDouble);
+    exact.run(ensembleSteps);
+    std::cout << ",\n  \"ensemble\": [";
+    for (int p = 0; p < 3; ++p) {
+        Ensemble ensemble(members, deltat, static_cast<EnsemblePrecision>(p));
+        Clock::time_point start = Clock::now();
+        ensemble.run(ensembleSteps);
+        double elapsed = seconds(start);
+        double error = 0;
+        for (size_t i = 0; i < members.size(); ++i) {
+            double drift = std::fabs(exact.getH(i) - exact.getInitialH(i));
+            error = std::max(error, std::fabs(ensemble.getH(i) - exact.getH(i)) / drift);
+        }
+        std::cout << (p ? ",\n" : "\n") << "    {\"precision\": \"" << names[p]
+                  << "\", \"member_steps_per_second\": " << members.size() * ensembleSteps / elapsed
+                  << ", \"H_error_over_drift\": " << error << "}";
+    }
+    std::cout << "\n  ]";
+}
+
+void printSde(double deltat) {
+    std::vector<EnsembleMember> members = benchMembers();
+    const long sdeSteps = 2000;
+    Ensemble quiet(members, deltat, EnsembleDouble);
+    Clock::time_point quietStart = Clock::now();
+    quiet.run(sdeSteps);
+    double quietTime = seconds(quietStart);
+    std::cout << ",\n  \"sde\": {\"members\": " << members.size() << ", \"steps\": " << sdeSteps
+              << ", \"schemes\": [\n    {\"scheme\": \"deterministic\", \"member_steps_per_second\": "
+              << members.size() * sdeSteps / quietTime << "},";
+    const char* schemes[] = { "euler_maruyama", "milstein" };
+    for (int k = 0; k < 2; ++k) {
+        StochasticEnsemble noisy(members, deltat, 0.1, 0.1, static_cast<SdeScheme>(k));
+        Clock::time_point start = Clock::now();
+        noisy.run(sdeSteps);
+        double elapsed = seconds(start);
+        std::cout << "\n    {\"scheme\": \"" << schemes[k] << "\", \"member_steps_per_second\": "
+                  << members.size() * sdeSteps / elapsed << ", \"x0\": " << noisy.getX(0) << "}" << (k ? "" : ",");
+    }
+    const size_t normalCount = 1 << 22;
+    std::vector<double> z0(normalCount / 4), z1(normalCount / 4), z2(normalCount / 4), z3(normalCount / 4);
+    Clock::time_point philoxStart = Clock::now();
+    philoxNormals(1, 0, 0, normalCount / 4, z0.data(), z1.data(), z2.data(), z3.data());
+    double philoxTime = seconds(philoxStart);
+    std::mt19937_64 generator(1);
+    std::normal_distribution<double> normal;
+    Clock::time_point mtStart = Clock::now();
+    for (size_t i = 0; i < normalCount / 4; ++i) {
+        z0[i] += normal(generator);
+        z1[i] += normal(generator);
+        z2[i] += normal(generator);
+        z3[i] += normal(generator);
+    }
+    double mtTime = seconds(mtStart);
+    std::cout << "\n  ], \"normals_per_second\": {\"philox\": " << normalCount / philoxTime
+              << ", \"mt19937_64\": " << normalCount / mtTime << "}, \"check\": " << z0[17] + z1[17] << "}";
+}
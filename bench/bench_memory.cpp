@@ -0,0 +1,100 @@
+// Memory sections of the bench. sweep runs 1000 simulations, 100 alive at a
+// time, on the heap and on a thread arena, each in a child process for the
+// peak RSS it adds to the forked bench; the arena is faster but its peak RSS
+// is no lower. huge_pages times a run of --scan-steps steps and a scan of its
+// trajectory on the heap and on HugePageResource, with the dTLB read misses
+// of each scan (-1 where perf_event cannot count them).
+#include "bench.hpp"
+#include "header.hpp"
+#include "measure.hpp"
+#include "perf_counters.hpp"
+#include <iostream>
+#include <vector>
+
+namespace {
+
+void sweep(bool arena) {
+    const int batches = 10, batchSize = 100;
+    for (int b = 0; b < batches; ++b) {
+        MemoryResource* resource = arena ? &threadArena() : 0;
+        std::vector<Simulation*> batch;
+        for (int i = 0; i < batchSize; ++i) {
+            batch.push_back(new Simulation(1200.0, 1000.0, 1.5 + 0.001 * (b * batchSize + i), 0.02, 0.01, 1.0,
+                                           0.001, resource));
+            batch.back()->runSimulation(17.0);
+        }
+        for (int i = 0; i < batchSize; ++i) {
+            delete batch[i];
+        }
+        if (arena) {
+            threadArena().reset();
+        }
+    }
+}
+
+void heapSweep() {
+    sweep(false);
+}
+
+void arenaSweep() {
+    sweep(true);
+}
+
+// runs sweep in a child; returns its wall time and the peak RSS it added to
+// what it inherited from the bench process, or -1 on failure
+void measureSweep(bool arena, double& wallSeconds, long& addedRssKb) {
+    std::vector<double> times;
+    long peakRssKb, forkRssKb;
+    bool ok = measureInChild(arena ? arenaSweep : heapSweep, 1, times, peakRssKb, forkRssKb);
+    wallSeconds = ok ? times[0] : -1;
+    addedRssKb = ok ? peakRssKb - forkRssKb : -1;
+}
+
+// scanTlbMisses is the dTLB read misses of the scan, -1 where perf_event
+// cannot count them
+void measureScan(long steps, MemoryResource* resource, double& runSeconds, double& scanSeconds,
+                 long long& scanTlbMisses) {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001, resource);
+    Clock::time_point start = Clock::now();
+    sim.runSimulation(steps * 0.001 + 0.0005);
+    runSeconds = seconds(start);
+
+    std::vector<double> t, v;
+    PerfCounters& counters = PerfCounters::instance();
+    unsigned long long missesBefore = 0, missesAfter = 0;
+    bool counted = counters.sample(PerfCounters::TlbMisses, missesBefore);
+    start = Clock::now();
+    TrajectoryView times = sim.getTimeView();
+    downsample(times.data(), sim.getXView().data(), times.size(), 2000, MinMax, t, v);
+    downsample(times.data(), sim.getYView().data(), times.size(), 2000, MinMax, t, v);
+    scanSeconds = seconds(start);
+    counted = counted && counters.sample(PerfCounters::TlbMisses, missesAfter);
+    scanTlbMisses = counted ? static_cast<long long>(missesAfter - missesBefore) : -1;
+}
+
+}
+
+void printSweep() {
+    double heapTime, arenaTime;
+    long heapRss, arenaRss;
+    measureSweep(false, heapTime, heapRss);
+    measureSweep(true, arenaTime, arenaRss);
+    std::cout << ",\n  \"sweep\": {\"simulations\": 1000, \"heap_seconds\": " << heapTime
+              << ", \"heap_added_rss_kb\": " << heapRss << ", \"arena_seconds\": " << arenaTime
+              << ", \"arena_added_rss_kb\": " << arenaRss << "}";
+}
+
+void printHugePages(long steps) {
+    double heapRun, heapScan, hugeRun, hugeScan;
+    long long heapMisses, hugeMisses;
+    HugePageResource hugePages;
+    measureScan(steps, 0, heapRun, heapScan, heapMisses);
+    measureScan(steps, &hugePages, hugeRun, hugeScan, hugeMisses);
+    std::cout << ",\n  \"huge_pages\": {\"steps\": " << steps
+              << ", \"heap_run_seconds\": " << heapRun << ", \"heap_scan_seconds\": " << heapScan
+              << ", \"heap_scan_dtlb_misses\": " << heapMisses
+              << ", \"huge_run_seconds\": " << hugeRun << ", \"huge_scan_seconds\": " << hugeScan
+              << ", \"huge_scan_dtlb_misses\": " << hugeMisses
+              << ", \"transparent_allocations\": " << hugePages.getTransparentAllocations()
+              << ", \"fallback_allocations\": " << hugePages.getFallbackAllocations() << "}";
+}
@@ -0,0 +1,130 @@
+// Model sections of the bench. precision runs the storage-free engine for
+// 10^6 steps in every scalar type and compares the final x with the most
+// precise one. models gives the stepping rate of each ModelSimulation
+// right-hand side next to the double engine, and seasonal forcing read from
+// tables against cos evaluated every step. delay steps DelaySimulation with a
+// delay on the step grid and one between steps; the same logistic model
+// without memory is the no_memory row of models.
+#include "bench.hpp"
+#include "engine.hpp"
+#include "models.hpp"
+#include "delay.hpp"
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+const long modelSteps = 1000000;
+
+// seasonal Lotka-Volterra evaluating the forcing at every step
+struct CosSeasonalModel {
+    double omega, deltat;
+    long step;
+
+    void rates(double x, double y, double& dx, double& dy) const {
+        double t = step * deltat;
+        dx = (2.0 * (1 + 0.3 * std::cos(omega * t)) - 0.02 * y) * x;
+        dy = (0.01 * x - (1 + 0.2 * std::cos(omega * t + 1.5707963267948966))) * y;
+    }
+
+    double invariant(double x, double y) const { return x + y; }
+
+    void advance() { ++step; }
+
+    // 1e-6 of the equilibrium of the mean parameters
+    void floors(double& x, double& y) const {
+        x = 1e-4;
+        y = 1e-4;
+    }
+};
+
+template <typename Model>
+void modelRow(const char* name, const Model& model, double x0, double y0, long steps, bool last) {
+    ModelSimulation<Model> sim(model, x0, y0, 0.001);
+    Clock::time_point start = Clock::now();
+    sim.run(steps);
+    double elapsed = seconds(start);
+    std::cout << "\n    {\"model\": \"" << name << "\", \"steps_per_second\": " << steps / elapsed
+              << ", \"invariant\": " << sim.getInvariant() << "}" << (last ? "" : ",");
+}
+
+void delayRow(const char* name, double tau, double preyDelay, long steps, bool last) {
+    DelaySimulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001, tau, preyDelay, 5000.0);
+    Clock::time_point start = Clock::now();
+    for (long k = 0; k < steps; ++k) {
+        sim.evolve();
+    }
+    double elapsed = seconds(start);
+    std::cout << "\n    {\"model\": \"" << name << "\", \"steps_per_second\": " << steps / elapsed
+              << ", \"x\": " << sim.getX() << "}" << (last ? "" : ",");
+}
+
+template <typename T>
+void precisionRow(const char* name, long steps, long double reference, bool last) {
+    Clock::time_point start = Clock::now();
+    EngineResult<T> r = runEngine<T>(1200, 1000, 2, T(2) / 100, T(1) / 100, 1, T(1) / 1000, steps);
+    double elapsed = seconds(start);
+    long double x = static_cast<long double>(r.x);
+    std::cout << "\n    {\"type\": \"" << name << "\", \"steps_per_second\": " << steps / elapsed
+              << ", \"max_H_drift\": " << static_cast<double>(r.maxDrift)
+              << ", \"final_H_drift\": " << static_cast<double>(r.H - r.H0)
+              << ", \"x_relative_error\": " << static_cast<double>((x - reference) / reference) << "}"
+              << (last ? "" : ",");
+}
+
+}
+
+void printPrecision() {
+    const long precisionSteps = 1000000;
+#ifdef SIM_HAVE_FLOAT128
+    typedef __float128 Reference;
+#else
+    typedef long double Reference;
+#endif
+    long double reference = static_cast<long double>(
+        runEngine<Reference>(1200, 1000, 2, Reference(2) / 100, Reference(1) / 100, 1, Reference(1) / 1000,
+                             precisionSteps, 0).x);
+    std::cout << ",\n  \"precision\": [";
+    precisionRow<float>("float", precisionSteps, reference, false);
+    precisionRow<double>("double", precisionSteps, reference, false);
+#ifdef SIM_HAVE_FLOAT128
+    precisionRow<long double>("long double", precisionSteps, reference, false);
+    precisionRow<__float128>("__float128", precisionSteps, reference, true);
+#else
+    precisionRow<long double>("long double", precisionSteps, reference, true);
+#endif
+    std::cout << "\n  ]";
+}
+
+void printModels() {
+    Clock::time_point engineStart = Clock::now();
+    EngineResult<double> engine = runEngine(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001, modelSteps, 0);
+    double engineTime = seconds(engineStart);
+    std::cout << ",\n  \"models\": [\n    {\"model\": \"engine_double\", \"steps_per_second\": "
+              << modelSteps / engineTime << ", \"invariant\": " << engine.H << "},";
+    modelRow("lotka_volterra", LotkaVolterraModel<double>(2.0, 0.02, 0.01, 1.0), 1200.0, 1000.0, modelSteps,
+             false);
+    modelRow("logistic_linear", PredatorPreyModel<double, LinearResponse>(1.0, 100.0, LinearResponse<double>(0.02),
+                                                                          0.5, 0.2), 50.0, 20.0, modelSteps, false);
+    modelRow("rosenzweig_macarthur", RosenzweigMacArthur<double>(1.0, 100.0, 0.02, 0.5, 0.5, 0.2), 50.0, 20.0,
+             modelSteps, false);
+    modelRow("holling_type_iii", PredatorPreyModel<double, HollingTypeIII>(1.0, 100.0, HollingTypeIII<double>(0.001, 0.5),
+                                                                           0.5, 0.2), 50.0, 20.0, modelSteps, false);
+    ForcingTable seasonA = ForcingTable::seasonal(2.0, 0.3, 5.0, 0.0, 0.001);
+    ForcingTable seasonD = ForcingTable::seasonal(1.0, 0.2, 5.0, 1.5707963267948966, 0.001);
+    modelRow("seasonal_table", SeasonalLotkaVolterra<double>(seasonA, 0.02, 0.01, seasonD), 1200.0, 1000.0,
+             modelSteps, false);
+    CosSeasonalModel cosModel = { 2 * 3.14159265358979323846 / 5.0, 0.001, 0 };
+    modelRow("seasonal_cos", cosModel, 1200.0, 1000.0, modelSteps, false);
+    // reference for the delay section: its logistic model without memory
+    modelRow("no_memory", PredatorPreyModel<double, LinearResponse>(2.0, 5000.0, LinearResponse<double>(0.02), 0.5, 1.0),
+             1200.0, 1000.0, modelSteps, true);
+    std::cout << "\n  ]";
+}
+
+void printDelay() {
+    std::cout << ",\n  \"delay\": [";
+    delayRow("grid", 0.05, 0.0, modelSteps, false);
+    delayRow("interpolated", 0.0504, 0.03, modelSteps, true);
+    std::cout << "\n  ]";
+}
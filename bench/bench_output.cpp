@@ -0,0 +1,45 @@
+// Output section of the bench: writer compares run-then-saveResults with
+// AsyncWriter for CSV and binary output over 10^6 steps (up to --save-max).
+#include "bench.hpp"
+#include "header.hpp"
+#include "async_writer.hpp"
+#include <iostream>
+
+namespace {
+
+// run plus output, synchronous (saveResults) or through an AsyncWriter
+void writerRow(const char* name, long steps, int mode, bool last) {
+    const char* scratch = "bench_writer.out";
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    AsyncWriter* writer = 0;
+    if (mode != 0) {
+        writer = new AsyncWriter(sim, scratch, mode == 1 ? OutputCsv : OutputBinary);
+        sim.addObserver(writer);
+    }
+    Clock::time_point start = Clock::now();
+    sim.runSimulation(steps * 0.001 + 0.0005);
+    size_t stalls = 0;
+    if (writer) {
+        writer->close();
+        stalls = writer->getStalls();
+        delete writer;
+    }
+    else {
+        sim.saveResults(scratch);
+    }
+    double elapsed = seconds(start);
+    std::cout << "\n    {\"output\": \"" << name << "\", \"seconds\": " << elapsed
+              << ", \"mb_per_second\": " << fileSize(scratch) / elapsed / 1e6 << ", \"stalls\": " << stalls << "}"
+              << (last ? "" : ",");
+    std::remove(scratch);
+}
+
+}
+
+void printWriter(long steps) {
+    std::cout << ",\n  \"writer\": {\"steps\": " << steps << ", \"outputs\": [";
+    writerRow("csv_sync", steps, 0, false);
+    writerRow("csv_async", steps, 1, false);
+    writerRow("binary_async", steps, 2, true);
+    std::cout << "\n  ]}";
+}
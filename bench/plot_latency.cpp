@@ -0,0 +1,59 @@
+// Plot latency for a 10^6-step run: text send1d, inline binary and the
+// downsampled binary path of plotResultsWithGnuplot. Output goes to gnuplot's
+// "unknown" terminal so only transfer and parsing are measured.
+//
+//   cmake --build build --target plot_latency && build/plot_latency
+#include "header.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <gnuplot-iostream.h>
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main() {
+    setenv("GNUTERM", "unknown", 1);
+
+    double deltat = 0.001;
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, deltat);
+    sim.runSimulation(1000.0);
+
+    const std::vector<double>& t = sim.getTimeValues();
+    const std::vector<double>& x = sim.getXValues();
+    const std::vector<double>& y = sim.getYValues();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        Gnuplot gp;
+        gp << "plot '-' using 1:2 with lines, '-' using 1:2 with lines\n";
+        gp.send1d(boost::make_tuple(t, x));
+        gp.send1d(boost::make_tuple(t, y));
+    }
+    double text = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    {
+        Gnuplot gp;
+        gp << "plot '-' binary" << gp.binFmt1d(boost::make_tuple(t, x), "record") << "using 1:2 with lines, "
+           << "'-' binary" << gp.binFmt1d(boost::make_tuple(t, y), "record") << "using 1:2 with lines\n";
+        gp.sendBinary1d(boost::make_tuple(t, x));
+        gp.sendBinary1d(boost::make_tuple(t, y));
+    }
+    double binary = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    sim.plotResultsWithGnuplot();
+    double downsampled = elapsedMs(start);
+
+    std::cout << "punti: " << x.size() << "\n";
+    std::cout << "send1d testo:           " << text << " ms\n";
+    std::cout << "binario completo:       " << binary << " ms\n";
+    std::cout << "plotResultsWithGnuplot: " << downsampled << " ms\n";
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Output backends for a sweep of 10,000 runs of one time unit, each saving
+// its results.csv-formatted trajectory to its own file, from one worker per
+// hardware thread: no output (run and formatting only), an ofstream per
+// file, SweepWriter with pwrite, with io_uring and with io_uring + O_DIRECT.
+//
+//   cmake --build build --target sweep_output
+//   build/sweep_output [directory] [runs]
+#include "header.hpp"
+#include "sweep_writer.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+enum Mode { NoOutput, Ofstream, Pwrite, IoUring, IoUringDirect };
+
+std::string format(const Simulation& sim) {
+    std::ostringstream text;
+    text << "time,x,y,H\n";
+    for (size_t i = 0; i < sim.getXValues().size(); ++i) {
+        text << sim.getTimeValues()[i] << "," << sim.getXValues()[i] << "," << sim.getYValues()[i] << ","
+             << sim.getHValues()[i] << "\n";
+    }
+    return text.str();
+}
+
+void sweep(Mode mode, const std::string& directory, int runs, SweepWriter* writer) {
+    unsigned threads = std::thread::hardware_concurrency();
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < (threads > 0 ? threads : 1); ++w) {
+        workers.push_back(std::thread([&]() {
+            Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+            for (int i = next++; i < runs; i = next++) {
+                sim.reset(1200.0, 1000.0, 1.5 + 1e-4 * i, 0.02, 0.01, 1.0, 0.001);
+                sim.runSimulation(1.0);
+                std::string contents = format(sim);
+                std::ostringstream name;
+                name << directory << "/run" << i << ".csv";
+                if (mode == Ofstream) {
+                    std::ofstream file(name.str().c_str());
+                    file << contents;
+                }
+                else if (mode != NoOutput) {
+                    writer->writeFile(name.str(), contents);
+                }
+            }
+        }));
+    }
+    for (size_t w = 0; w < workers.size(); ++w) {
+        workers[w].join();
+    }
+    if (writer) {
+        writer->flush();
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string directory = argc > 1 ? argv[1] : "sweep_output";
+    int runs = argc > 2 ? std::atoi(argv[2]) : 10000;
+    mkdir(directory.c_str(), 0755);
+
+    const char* names[] = { "none", "ofstream", "pwrite", "io_uring", "io_uring_direct" };
+    std::cout << "{\n  \"runs\": " << runs << ",\n  \"threads\": " << std::thread::hardware_concurrency()
+              << ",\n  \"backends\": [";
+    for (int m = NoOutput; m <= IoUringDirect; ++m) {
+        Mode mode = static_cast<Mode>(m);
+        SweepWriter* writer = 0;
+        if (mode == Pwrite || mode == IoUring || mode == IoUringDirect) {
+            writer = new SweepWriter(mode == Pwrite ? WriterPwrite : WriterIoUring, 64, 1 << 16, mode == IoUringDirect);
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        sweep(mode, directory, runs, writer);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << (m ? ",\n" : "\n") << "    {\"backend\": \"" << names[m] << "\", \"seconds\": " << seconds
+                  << ", \"runs_per_second\": " << runs / seconds;
+        if (writer) {
+            std::cout << ", \"used\": \"" << (writer->getBackend() == WriterIoUring ? "io_uring" : "pwrite")
+                      << "\", \"mb_per_second\": " << writer->getBytes() / seconds / 1e6
+                      << ", \"syscalls\": " << writer->getSyscalls()
+                      << ", \"direct_files\": " << writer->getDirectFiles()
+                      << ", \"errors\": " << writer->getErrors();
+            delete writer;
+        }
+        std::cout << "}";
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+
+    for (int i = 0; i < runs; ++i) {
+        std::ostringstream name;
+        name << directory << "/run" << i << ".csv";
+        std::remove(name.str().c_str());
+    }
+    rmdir(directory.c_str());
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "adjoint.hpp"
+#include "lotka_volterra.hpp"
+#include <algorithm>
+
+ObservationLoss::ObservationLoss(const std::vector<Observation>& observations, double deltat)
+    : targets(observations) {
+    std::sort(targets.begin(), targets.end(),
+              [](const Observation& a, const Observation& b) { return a.t < b.t; });
+    for (size_t k = 0; k < targets.size(); ++k) {
+        steps.push_back(std::max(0L, std::lround(targets[k].t / deltat)));
+    }
+}
+
+double ObservationLoss::evaluate(long step, double x, double y, double& dx, double& dy) const {
+    dx = dy = 0;
+    double loss = 0;
+    std::vector<long>::const_iterator it = std::lower_bound(steps.begin(), steps.end(), step);
+    for (; it != steps.end() && *it == step; ++it) {
+        const Observation& obs = targets[it - steps.begin()];
+        double rx = x - obs.x, ry = y - obs.y;
+        loss += 0.5 * (rx * rx + ry * ry);
+        dx += rx;
+        dy += ry;
+    }
+    return loss;
+}
+
+AdjointResult computeAdjointGradient(const FitParameters& p, double deltat, double totalTime,
+                                     const TrajectoryLoss& loss, long checkpointBudget) {
+    const double A = p.A, B = p.B, C = p.C, D = p.D, dt = deltat;
+    long steps = static_cast<long>(totalTime / deltat);
+    long budget = std::max(1L, checkpointBudget);
+    long segment = std::max(1L, (steps + budget - 1) / budget);
+
+    AdjointResult result;
+    result.loss = 0;
+    result.segmentLength = segment;
+    double dx, dy;
+
+    // forward pass: loss and checkpoints every segment steps; the final
+    // sample starts no segment, so it gets no checkpoint
+    std::vector<LotkaVolterra<double> > checkpoints;
+    LotkaVolterra<double> model(p.x0, p.y0, A, B, C, D, deltat);
+    for (long n = 0; n <= steps; ++n) {
+        if (n < steps && n % segment == 0) {
+            checkpoints.push_back(model);
+        }
+        result.loss += loss.evaluate(n, model.getX(), model.getY(), dx, dy);
+        if (n < steps) {
+            model.evolve();
+        }
+    }
+    result.checkpoints = static_cast<long>(checkpoints.size());
+
+    // backward pass, one recomputed segment at a time
+    double gA = 0, gB = 0, gC = 0, gD = 0;
+    double ax = 0, ay = 0;
+    std::vector<double> xs(segment + 1), ys(segment + 1);
+    for (long s = static_cast<long>(checkpoints.size()) - 1; s >= 0; --s) {
+        long begin = s * segment;
+        long end = std::min(begin + segment, steps);
+        LotkaVolterra<double> replay = checkpoints[s];
+        for (long n = begin; n <= end; ++n) {
+            xs[n - begin] = replay.getX();
+            ys[n - begin] = replay.getY();
+            if (n < end) {
+                replay.evolve();
+            }
+        }
+
+        for (long n = end; n > begin; --n) {
+            loss.evaluate(n, xs[n - begin], ys[n - begin], dx, dy);
+            ax += dx;
+            ay += dy;
+
+            // transpose of the Euler step from sample n-1 to n, including the clamp
+            double x = xs[n - 1 - begin], y = ys[n - 1 - begin];
+            bool clampX = !(x + (A - B * y) * x * dt > 0);
+            bool clampY = !(y + (C * x - D) * y * dt > 0);
+            double px = clampX ? 0 : ax;
+            double py = clampY ? 0 : ay;
+            gA += px * x * dt;
+            gB -= px * x * y * dt;
+            gC += py * x * y * dt;
+            gD -= py * y * dt;
+            if (clampX) {
+                double floor = 1e-6 * D / C;
+                gC -= ax * floor / C;
+                gD += ax * floor / D;
+            }
+            if (clampY) {
+                double floor = 1e-6 * A / B;
+                gA += ay * floor / A;
+                gB -= ay * floor / B;
+            }
+            ax = px * (1 + (A - B * y) * dt) + py * C * y * dt;
+            ay = -px * B * x * dt + py * (1 + (C * x - D) * dt);
+        }
+    }
+    loss.evaluate(0, p.x0, p.y0, dx, dy);
+    ax += dx;
+    ay += dy;
+
+    FitParameters gradient = { gA, gB, gC, gD, ax, ay };
+    result.gradient = gradient;
+    return result;
+}
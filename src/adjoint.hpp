@@ -0,0 +1,42 @@
+#ifndef ADJOINT_HPP
+#define ADJOINT_HPP
+
+#include "fit.hpp"
+#include <vector>
+
+// Scalar loss summed over the samples of a run.
+class TrajectoryLoss {
+public:
+    virtual ~TrajectoryLoss() {}
+    // contribution of sample number step, with its derivatives in dx and dy
+    virtual double evaluate(long step, double x, double y, double& dx, double& dy) const = 0;
+};
+
+// 0.5 * squared distance to the observations, each compared with the
+// sample nearest to its time as in fitParameters.
+class ObservationLoss : public TrajectoryLoss {
+public:
+    ObservationLoss(const std::vector<Observation>& observations, double deltat);
+    double evaluate(long step, double x, double y, double& dx, double& dy) const;
+
+private:
+    std::vector<long> steps;  // sorted
+    std::vector<Observation> targets;
+};
+
+struct AdjointResult {
+    double loss;
+    FitParameters gradient;  // dLoss/dA, ..., dLoss/dy0
+    long checkpoints;
+    long segmentLength;
+};
+
+// Gradient of the loss over a run of Simulation's Euler scheme by backward
+// integration of the discrete adjoint. The forward pass keeps at most
+// checkpointBudget states and each segment between checkpoints is recomputed
+// once during the backward sweep, so the cost is about two simulations
+// whatever the number of parameters.
+AdjointResult computeAdjointGradient(const FitParameters& parameters, double deltat, double totalTime,
+                                     const TrajectoryLoss& loss, long checkpointBudget);
+
+#endif // ADJOINT_HPP
@@ -0,0 +1,110 @@
+#include "async_writer.hpp"
+#include <chrono>
+
+AsyncWriter::AsyncWriter(const Simulation& sim, const std::string& filename, OutputFormat format,
+                         size_t bufferSamples)
+    : model(sim.getModel()), format(format), file(std::fopen(filename.c_str(), format == OutputCsv ? "w" : "wb")),
+      bufferSamples(bufferSamples > 0 ? bufferSamples : 1), pending(false), closing(false), bytesWritten(0),
+      stalls(0), stallSeconds(0) {
+    if (!file) {
+        return;
+    }
+    filling.reserve(this->bufferSamples);
+    writing.reserve(this->bufferSamples);
+    if (format == OutputCsv) {
+        bytesWritten += std::fputs("time,x,y,H\n", file) >= 0 ? 11 : 0;
+    }
+    writer = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+    close();
+}
+
+void AsyncWriter::observe(double t, double x, double y) {
+    if (!file) {
+        return;
+    }
+    Sample sample = { t, x, y };
+    filling.push_back(sample);
+    if (filling.size() == bufferSamples) {
+        handOff();
+    }
+}
+
+// gives the full buffer to the writer once it has finished the previous one
+void AsyncWriter::handOff() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (pending) {
+        ++stalls;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (pending) {
+            done.wait(lock);
+        }
+        stallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    filling.swap(writing);
+    filling.clear();
+    pending = true;
+    ready.notify_one();
+}
+
+void AsyncWriter::close() {
+    if (!file) {
+        return;
+    }
+    if (!filling.empty()) {
+        handOff();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    ready.notify_one();
+    writer.join();
+    std::fclose(file);
+    file = 0;
+}
+
+void AsyncWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        while (!pending && !closing) {
+            ready.wait(lock);
+        }
+        if (!pending) {
+            return;
+        }
+        // the integration thread does not touch writing until pending is cleared
+        lock.unlock();
+        write(writing);
+        lock.lock();
+        pending = false;
+        done.notify_one();
+    }
+}
+
+void AsyncWriter::write(const std::vector<Sample>& samples) {
+    if (format == OutputBinary) {
+        std::vector<double> records(4 * samples.size());
+        for (size_t i = 0; i < samples.size(); ++i) {
+            records[4 * i] = samples[i].t;
+            records[4 * i + 1] = samples[i].x;
+            records[4 * i + 2] = samples[i].y;
+            records[4 * i + 3] = model.calculateH(samples[i].x, samples[i].y);
+        }
+        bytesWritten += sizeof(double) * std::fwrite(records.data(), sizeof(double), records.size(), file);
+        return;
+    }
+
+    // %g is what an ostream prints with its default precision of 6
+    const size_t maxLine = 4 * 32;
+    text.resize(samples.size() * maxLine);
+    size_t used = 0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        int n = std::snprintf(&text[used], maxLine, "%g,%g,%g,%g\n", samples[i].t, samples[i].x, samples[i].y,
+                              model.calculateH(samples[i].x, samples[i].y));
+        used += n > 0 ? static_cast<size_t>(n) : 0;
+    }
+    bytesWritten += std::fwrite(text.data(), 1, used, file);
+}
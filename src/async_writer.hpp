@@ -0,0 +1,69 @@
+#ifndef ASYNC_WRITER_HPP
+#define ASYNC_WRITER_HPP
+
+#include "header.hpp"
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum OutputFormat { OutputCsv, OutputBinary };
+
+// Writes the samples of runSimulation to a file while the run is going. The
+// integration loop fills one buffer while a background thread computes H,
+// formats and writes the other; when the writer falls behind, observe waits
+// for it (backpressure) instead of buffering without bound. CSV output is the
+// same as saveResults; binary output is one record of four doubles
+// (time, x, y, H) per sample, in native byte order.
+//
+// H is computed from a copy of the model parameters taken at construction, so
+// the writer thread never touches the Simulation and close() may run after the
+// Simulation is gone. A reset with new parameters is not seen: close the writer
+// before resetting. The Simulation keeps a pointer to its observers, so the
+// writer must outlive every runSimulation it is added to.
+class AsyncWriter : public SimulationObserver {
+public:
+    AsyncWriter(const Simulation& sim, const std::string& filename, OutputFormat format = OutputCsv,
+                size_t bufferSamples = 1 << 16);
+    ~AsyncWriter();
+
+    bool isOpen() const { return file != 0; }
+
+    void observe(double t, double x, double y);
+
+    // writes what is buffered, joins the writer thread and closes the file
+    void close();
+
+    size_t getBytesWritten() const { return bytesWritten; }
+    // times observe had to wait for the writer, and for how long in total
+    size_t getStalls() const { return stalls; }
+    double getStallSeconds() const { return stallSeconds; }
+
+private:
+    struct Sample {
+        double t, x, y;
+    };
+
+    void handOff();
+    void run();
+    void write(const std::vector<Sample>& samples);
+
+    LotkaVolterra<double> model;
+    OutputFormat format;
+    std::FILE* file;
+    size_t bufferSamples;
+
+    std::vector<Sample> filling, writing;
+    std::mutex mutex;
+    std::condition_variable ready, done;
+    bool pending, closing;
+
+    std::vector<char> text;
+    size_t bytesWritten, stalls;
+    double stallSeconds;
+    std::thread writer;
+};
+
+#endif // ASYNC_WRITER_HPP
@@ -0,0 +1,124 @@
+#include "batch.hpp"
+#include "header.hpp"
+#include "trace.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+Job::Job()
+    : x0(1200.0), y0(1000.0), A(2.0), B(0.02), C(0.01), D(1.0), deltat(0.001), totalTime(0.0),
+      integrator("euler") {
+}
+
+bool parseJob(const std::string& line, Job& job, std::string& error) {
+    std::istringstream fields(line);
+    std::string field;
+    while (fields >> field) {
+        size_t eq = field.find('=');
+        if (eq == std::string::npos || eq == 0) {
+            error = "campo non valido: " + field;
+            return false;
+        }
+        std::string key = field.substr(0, eq);
+        std::string value = field.substr(eq + 1);
+
+        if (key == "out") {
+            job.output = value;
+            continue;
+        }
+        if (key == "integrator") {
+            if (value != "euler") {
+                error = "integratore non supportato: " + value;
+                return false;
+            }
+            job.integrator = value;
+            continue;
+        }
+
+        char* end = 0;
+        double number = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0') {
+            error = "numero non valido per " + key + ": " + value;
+            return false;
+        }
+        if (key == "x0") {
+            job.x0 = number;
+        }
+        else if (key == "y0") {
+            job.y0 = number;
+        }
+        else if (key == "A") {
+            job.A = number;
+        }
+        else if (key == "B") {
+            job.B = number;
+        }
+        else if (key == "C") {
+            job.C = number;
+        }
+        else if (key == "D") {
+            job.D = number;
+        }
+        else if (key == "deltat") {
+            job.deltat = number;
+        }
+        else if (key == "time") {
+            job.totalTime = number;
+        }
+        else {
+            error = "chiave sconosciuta: " + key;
+            return false;
+        }
+    }
+
+    // H takes logs of x and y and divides by B and C: zero, negative or
+    // infinite values would run into inf and NaN rows
+    const char* names[] = { "x0", "y0", "A", "B", "C", "D", "deltat" };
+    const double values[] = { job.x0, job.y0, job.A, job.B, job.C, job.D, job.deltat };
+    for (int i = 0; i < 7; ++i) {
+        if (!(values[i] > 0) || !std::isfinite(values[i])) {
+            error = std::string(names[i]) + " deve essere un numero positivo";
+            return false;
+        }
+    }
+    if (!(job.totalTime >= 0) || !std::isfinite(job.totalTime)) {
+        error = "time non deve essere negativo";
+        return false;
+    }
+    return true;
+}
+
+int runBatch(std::istream& in, std::ostream& out) {
+    Job defaults;
+    Simulation sim(defaults.x0, defaults.y0, defaults.A, defaults.B, defaults.C, defaults.D, defaults.deltat);
+
+    out << "job,x,y,H\n";
+    std::string line, error;
+    int index = 0, lineNumber = 0, failed = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        ++index;
+
+        TRACE_SCOPE("job");
+        Job job;
+        if (!parseJob(line, job, error)) {
+            std::cerr << "Errore nel job " << index << " (riga " << lineNumber << "): " << error << "\n";
+            ++failed;
+            continue;
+        }
+
+        sim.reset(job.x0, job.y0, job.A, job.B, job.C, job.D, job.deltat);
+        sim.runSimulation(job.totalTime);
+        if (!job.output.empty()) {
+            sim.saveResults(job.output);
+        }
+        out << index << "," << sim.getX() << "," << sim.getY() << "," << sim.getH() << "\n";
+    }
+    out.flush();
+    return failed;
+}
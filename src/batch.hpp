@@ -0,0 +1,29 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <iosfwd>
+#include <string>
+
+// One line of a batch job stream: whitespace separated key=value pairs,
+// e.g. "A=2 B=0.02 C=0.01 D=1 x0=1200 y0=1000 deltat=0.001 time=17 out=run1.csv".
+// Keys left out keep the defaults of the interactive program.
+struct Job {
+    double x0, y0, A, B, C, D, deltat, totalTime;
+    std::string integrator;
+    std::string output;  // empty: results are not saved
+
+    Job();
+};
+
+// Returns false with a message in error if the line is malformed, or if x0,
+// y0, A-D or deltat are not positive and finite, or time is negative.
+bool parseJob(const std::string& line, Job& job, std::string& error);
+
+// Runs every job read from in back to back in one Simulation, without
+// prompts or plots, and writes "job,x,y,H" with the final state of each job
+// to out. Blank lines and lines starting with '#' are skipped. Jobs that fail
+// to parse are reported on stderr with their line number and skipped. Returns
+// the number of jobs that failed.
+int runBatch(std::istream& in, std::ostream& out);
+
+#endif // BATCH_HPP
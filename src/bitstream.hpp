@@ -0,0 +1,126 @@
+#ifndef BITSTREAM_HPP
+#define BITSTREAM_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+// Bit packing shared by the trajectory codecs: bits are stored most
+// significant first in 64-bit words.
+
+inline uint64_t toBits(double v) {
+    uint64_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+inline double fromBits(uint64_t b) {
+    double v;
+    std::memcpy(&v, &b, sizeof(v));
+    return v;
+}
+
+inline uint32_t floatToBits(float v) {
+    uint32_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+inline float floatFromBits(uint32_t b) {
+    float v;
+    std::memcpy(&v, &b, sizeof(v));
+    return v;
+}
+
+// writes the low n bits of value, most significant first
+inline void putBits(std::vector<uint64_t>& words, uint64_t& bits, uint64_t value, int n) {
+    if (n == 0) {
+        return;
+    }
+    if (n < 64) {
+        value &= (uint64_t(1) << n) - 1;
+    }
+    int used = static_cast<int>(bits & 63);
+    if (used == 0) {
+        words.push_back(0);
+    }
+    int room = 64 - used;
+    if (n <= room) {
+        words.back() |= value << (room - n);
+    }
+    else {
+        words.back() |= value >> (n - room);
+        words.push_back(value << (64 - (n - room)));
+    }
+    bits += n;
+}
+
+class BitReader {
+public:
+    BitReader(const uint64_t* words, uint64_t position) : words(words), bitPosition(position) {}
+
+    uint64_t get(int n) {
+        if (n == 0) {
+            return 0;
+        }
+        size_t word = static_cast<size_t>(bitPosition >> 6);
+        int used = static_cast<int>(bitPosition & 63);
+        bitPosition += n;
+        uint64_t head = words[word] << used;
+        if (used + n > 64) {
+            head |= words[word + 1] >> (64 - used);
+        }
+        return head >> (64 - n);
+    }
+
+    bool bit() { return get(1) != 0; }
+    uint64_t position() const { return bitPosition; }
+
+    // Elias gamma code of a value >= 1, see putGamma
+    uint64_t gamma() {
+        int zeros = 0;
+        while (!bit()) {
+            ++zeros;
+        }
+        return zeros ? (uint64_t(1) << zeros) | get(zeros) : 1;
+    }
+
+private:
+    const uint64_t* words;
+    uint64_t bitPosition;
+};
+
+inline int significantBits(uint64_t v) {
+    return v ? 64 - __builtin_clzll(v) : 0;
+}
+
+// Elias gamma: value >= 1 as its bit length minus one in zeros, then its bits
+inline void putGamma(std::vector<uint64_t>& words, uint64_t& bits, uint64_t value) {
+    int n = significantBits(value);
+    putBits(words, bits, 0, n - 1);
+    putBits(words, bits, value, n);
+}
+
+inline uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t z) {
+    return static_cast<int64_t>((z >> 1) ^ (0 - (z & 1)));
+}
+
+// fixed-size header fields of the codec files, in host byte order
+template <typename T>
+void writeValue(std::ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& v) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(v)));
+}
+
+#endif // BITSTREAM_HPP
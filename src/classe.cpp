@@ -1,74 +1,201 @@
 #include "header.hpp"
+#include "perf_counters.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <stdexcept>
 #include <gnuplot-iostream.h>
 
-Simulation::Simulation(double x0, double y0, double A, double B, double C, double D, double deltat)
-    : A(A), B(B), C(C), D(D), deltat(deltat) {
-    e2_x = D / C;
-    e2_y = A / B;
-    x_rel = x0 / e2_x;
-    y_rel = y0 / e2_y;
-    x_values.push_back(x0);
-    y_values.push_back(y0);
-    H_values.push_back(calculateH(x0, y0));
-    time_values.push_back(0.0);
+namespace {
+
+// The helpers below take either std::vector<double> or Trajectory.
+template <typename Series>
+void restart(Series& x, Series& y, Series& H, Series& t, double x0, double y0, double H0) {
+    x.clear();
+    y.clear();
+    H.clear();
+    t.clear();
+    x.push_back(x0);
+    y.push_back(y0);
+    H.push_back(H0);
+    t.push_back(0.0);
+}
+
+// grow once up front, at least geometrically so repeated short runs stay amortised
+template <typename Series>
+void reserveFor(size_t needed, Series& x, Series& y, Series& H, Series& t) {
+    if (needed > t.capacity()) {
+        size_t capacity = needed > 2 * t.capacity() ? needed : 2 * t.capacity();
+        x.reserve(capacity);
+        y.reserve(capacity);
+        H.reserve(capacity);
+        t.reserve(capacity);
+    }
+}
+
+template <typename Series>
+void append(Series& x, Series& y, Series& H, Series& t,
+            const double* bx, const double* by, const double* bH, const double* bt, int n) {
+    x.insert(x.end(), bx, bx + n);
+    y.insert(y.end(), by, by + n);
+    H.insert(H.end(), bH, bH + n);
+    t.insert(t.end(), bt, bt + n);
+}
+
+template <typename Series>
+TrajectoryView viewOf(const Series& s) {
+    return TrajectoryView(s.data(), s.size());
+}
+
+} // namespace
+
+Simulation::Simulation(double x0, double y0, double A, double B, double C, double D, double deltat,
+                       MemoryResource* resource)
+    : deltat(deltat), model(x0, y0, A, B, C, D, deltat), resource(resource),
+      x_stored(ResourceAllocator<double>(resource)), y_stored(ResourceAllocator<double>(resource)),
+      H_stored(ResourceAllocator<double>(resource)), time_stored(ResourceAllocator<double>(resource)),
+      initialObserved(false) {
+    TRACE_SCOPE("Simulation");
+    if (resource) {
+        restart(x_stored, y_stored, H_stored, time_stored, x0, y0, calculateH(x0, y0));
+    }
+    else {
+        restart(x_values, y_values, H_values, time_values, x0, y0, calculateH(x0, y0));
+    }
+}
+
+void Simulation::reset(double x0, double y0, double A, double B, double C, double D, double deltat) {
+    this->deltat = deltat;
+    model = LotkaVolterra<double>(x0, y0, A, B, C, D, deltat);
+    if (resource) {
+        restart(x_stored, y_stored, H_stored, time_stored, x0, y0, calculateH(x0, y0));
+    }
+    else {
+        restart(x_values, y_values, H_values, time_values, x0, y0, calculateH(x0, y0));
+    }
+    initialObserved = false;
 }
 
 void Simulation::evolve() {
-    double new_x_rel = x_rel + (A - B * y_rel * e2_y) * x_rel * deltat;
-    double new_y_rel = y_rel + (C * x_rel * e2_x - D) * y_rel * deltat;
-    x_rel = new_x_rel > 0 ? new_x_rel : 1e-6;
-    y_rel = new_y_rel > 0 ? new_y_rel : 1e-6;
+    model.evolve();
 }
 
 void Simulation::runSimulation(double totalTime) {
+    TRACE_SCOPE("runSimulation");
     int steps = static_cast<int>(totalTime / deltat);
-    for (int i = 0; i < steps; ++i) {
-        evolve();
-        double abs_x = x_rel * e2_x;
-        double abs_y = y_rel * e2_y;
-        x_values.push_back(abs_x);
-        y_values.push_back(abs_y);
-        H_values.push_back(calculateH(abs_x, abs_y));
-        time_values.push_back((i + 1) * deltat);
+    TrajectoryView times = getTimeView();
+    size_t offset = times.size() - 1;
+    // only the first run sends t = 0, even if it took no steps
+    if (!initialObserved) {
+        for (size_t k = 0; k < observers.size(); ++k) {
+            observers[k]->observe(times[0], getXView()[0], getYView()[0]);
+        }
+        initialObserved = true;
+    }
+
+    if (steps > 0) {
+        if (resource) {
+            reserveFor(times.size() + steps, x_stored, y_stored, H_stored, time_stored);
+        }
+        else {
+            reserveFor(times.size() + steps, x_values, y_values, H_values, time_values);
+        }
+    }
+
+    // Steps are taken in blocks so that stepping, H and storage can be
+    // measured separately; the per-block buffers stay in L1.
+    const int block = 1024;
+    double bx[block], by[block], bH[block], bt[block];
+    for (int done = 0; done < steps; done += block) {
+        int n = steps - done < block ? steps - done : block;
+        {
+            PerfScope scope(PhaseEvolve);
+            for (int j = 0; j < n; ++j) {
+                evolve();
+                bx[j] = model.getX();
+                by[j] = model.getY();
+            }
+        }
+        {
+            PerfScope scope(PhaseCalculateH);
+            for (int j = 0; j < n; ++j) {
+                bH[j] = calculateH(bx[j], by[j]);
+            }
+        }
+        PerfScope scope(PhaseAppend);
+        for (int j = 0; j < n; ++j) {
+            bt[j] = (offset + done + j + 1) * deltat;
+        }
+        if (resource) {
+            append(x_stored, y_stored, H_stored, time_stored, bx, by, bH, bt, n);
+        }
+        else {
+            append(x_values, y_values, H_values, time_values, bx, by, bH, bt, n);
+        }
+        for (int j = 0; j < n; ++j) {
+            for (size_t k = 0; k < observers.size(); ++k) {
+                observers[k]->observe(bt[j], bx[j], by[j]);
+            }
+        }
     }
 }
 
+void Simulation::addObserver(SimulationObserver* observer) {
+    observers.push_back(observer);
+}
+
 void Simulation::saveResults(const std::string& filename) const {
+    TRACE_SCOPE("saveResults");
+    PerfScope scope(PhaseSaveResults);
+    TrajectoryView t = getTimeView(), x = getXView(), y = getYView(), H = getHView();
     std::ofstream file(filename);
     file << "time,x,y,H\n";
-    for (size_t i = 0; i < x_values.size(); ++i) {
-        file << time_values[i] << "," << x_values[i] << "," << y_values[i] << "," << H_values[i] << "\n";
+    for (size_t i = 0; i < x.size(); ++i) {
+        file << t[i] << "," << x[i] << "," << y[i] << "," << H[i] << "\n";
     }
 }
 
-void Simulation::plotResultsWithGnuplot() const {
+void Simulation::plotResultsWithGnuplot(size_t maxPoints, DownsampleMode mode) const {
+    TRACE_SCOPE("plotResultsWithGnuplot");
+    PerfScope scope(PhasePlotting);
+    TrajectoryView times = getTimeView();
+    std::vector<double> tx, x, ty, y;
+    downsample(times.data(), getXView().data(), times.size(), maxPoints, mode, tx, x);
+    downsample(times.data(), getYView().data(), times.size(), maxPoints, mode, ty, y);
+
     Gnuplot gp;
     gp << "set title 'Prede e predatori in funzione del tempo'\n";
     gp << "set xlabel 'Tempo'\n";
     gp << "set ylabel 'Popolazione'\n";
-    gp << "plot '-' using 1:2 with lines notitle, '-' using 1:2 with lines notitle\n";
-    gp.send1d(boost::make_tuple(time_values, x_values));
-    gp.send1d(boost::make_tuple(time_values, y_values));
+    // inline binary records: no number formatting on either side of the pipe
+    gp << "plot '-' binary" << gp.binFmt1d(boost::make_tuple(tx, x), "record") << "using 1:2 with lines notitle, "
+       << "'-' binary" << gp.binFmt1d(boost::make_tuple(ty, y), "record") << "using 1:2 with lines notitle\n";
+    gp.sendBinary1d(boost::make_tuple(tx, x));
+    gp.sendBinary1d(boost::make_tuple(ty, y));
 }
 
-void Simulation::plotHWithGnuplot() const {
+void Simulation::plotHWithGnuplot(size_t maxPoints, DownsampleMode mode) const {
+    TRACE_SCOPE("plotHWithGnuplot");
+    PerfScope scope(PhasePlotting);
+    TrajectoryView times = getTimeView();
+    std::vector<double> t, H;
+    downsample(times.data(), getHView().data(), times.size(), maxPoints, mode, t, H);
+
     Gnuplot gp;
     gp << "set title 'H in funzione del tempo'\n";
     gp << "set xlabel 'Tempo'\n";
     gp << "set ylabel 'H'\n";
-    gp << "plot '-' using 1:2 with lines title 'H'\n";
-    gp.send1d(boost::make_tuple(time_values, H_values));
+    gp << "plot '-' binary" << gp.binFmt1d(boost::make_tuple(t, H), "record") << "using 1:2 with lines title 'H'\n";
+    gp.sendBinary1d(boost::make_tuple(t, H));
 }
 
 double Simulation::getX() const {
-    return x_rel * e2_x;
+    return model.getX();
 }
 
 double Simulation::getY() const {
-    return y_rel * e2_y;
+    return model.getY();
 }
 
 double Simulation::getH() const {
@@ -77,8 +204,9 @@ double Simulation::getH() const {
 
 double Simulation::getXAtTime(double time) const {
     int index = static_cast<int>(time / deltat);
-    if (index >= 0 && index < x_values.size()) {
-        return x_values[index];
+    TrajectoryView values = getXView();
+    if (index >= 0 && index < values.size()) {
+        return values[index];
     }
     else {
         return -1;
@@ -87,8 +215,9 @@ double Simulation::getXAtTime(double time) const {
 
 double Simulation::getYAtTime(double time) const {
     int index = static_cast<int>(time / deltat);
-    if (index >= 0 && index < y_values.size()) {
-        return y_values[index];
+    TrajectoryView values = getYView();
+    if (index >= 0 && index < values.size()) {
+        return values[index];
     }
     else {
         return -1;
@@ -97,14 +226,59 @@ double Simulation::getYAtTime(double time) const {
 
 double Simulation::getHAtTime(double time) const {
     int index = static_cast<int>(time / deltat);
-    if (index >= 0 && index < H_values.size()) {
-        return H_values[index];
+    TrajectoryView values = getHView();
+    if (index >= 0 && index < values.size()) {
+        return values[index];
     }
     else {
         return -1;
     }
 }
 
+const std::vector<double>& Simulation::getXValues() const {
+    if (resource) {
+        throw std::logic_error("Simulation::getXValues: trajectory is on a MemoryResource, use getXView");
+    }
+    return x_values;
+}
+
+const std::vector<double>& Simulation::getYValues() const {
+    if (resource) {
+        throw std::logic_error("Simulation::getYValues: trajectory is on a MemoryResource, use getYView");
+    }
+    return y_values;
+}
+
+const std::vector<double>& Simulation::getHValues() const {
+    if (resource) {
+        throw std::logic_error("Simulation::getHValues: trajectory is on a MemoryResource, use getHView");
+    }
+    return H_values;
+}
+
+const std::vector<double>& Simulation::getTimeValues() const {
+    if (resource) {
+        throw std::logic_error("Simulation::getTimeValues: trajectory is on a MemoryResource, use getTimeView");
+    }
+    return time_values;
+}
+
+TrajectoryView Simulation::getXView() const {
+    return resource ? viewOf(x_stored) : viewOf(x_values);
+}
+
+TrajectoryView Simulation::getYView() const {
+    return resource ? viewOf(y_stored) : viewOf(y_values);
+}
+
+TrajectoryView Simulation::getHView() const {
+    return resource ? viewOf(H_stored) : viewOf(H_values);
+}
+
+TrajectoryView Simulation::getTimeView() const {
+    return resource ? viewOf(time_stored) : viewOf(time_values);
+}
+
 double Simulation::calculateH(double x, double y) const {
-    return -D * std::log(x) + C * x + B * y - A * std::log(y);
+    return model.calculateH(x, y);
 }
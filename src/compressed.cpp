@@ -0,0 +1,281 @@
+#include "compressed.hpp"
+#include "header.hpp"
+#include "bitstream.hpp"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// a value costs from one bit (exact prediction) to 2 + 6 + 64 (new window)
+const uint64_t maxBitsPerValue = 72;
+
+void corrupt(const std::string& what) {
+    throw std::runtime_error("CompressedSeries::read: " + what);
+}
+
+// extrapolation through the last min(index, order) values: binomial
+// coefficients with alternating signs, in wrapping integer arithmetic
+const int64_t coefficients[CompressedSeries::order][CompressedSeries::order] = {
+    { 1 },
+    { 2, -1 },
+    { 3, -3, 1 },
+    { 4, -6, 4, -1 },
+    { 5, -10, 10, -5, 1 },
+    { 6, -15, 20, -15, 6, -1 },
+};
+
+inline uint64_t predict(const uint64_t* history, size_t index) {
+    int n = index < static_cast<size_t>(CompressedSeries::order) ? static_cast<int>(index)
+                                                                 : CompressedSeries::order;
+    uint64_t p = 0;
+    for (int j = 0; j < n; ++j) {
+        p += static_cast<uint64_t>(coefficients[n - 1][j]) * history[j];
+    }
+    return p;
+}
+
+inline void push(uint64_t* history, uint64_t value) {
+    for (int j = CompressedSeries::order - 1; j > 0; --j) {
+        history[j] = history[j - 1];
+    }
+    history[0] = value;
+}
+
+}
+
+const size_t CompressedSeries::blockSize;
+const int CompressedSeries::order;
+
+CompressedSeries::CompressedSeries() {
+    clear();
+}
+
+void CompressedSeries::clear() {
+    words.clear();
+    blocks.clear();
+    bits = 0;
+    count = 0;
+    for (int j = 0; j < order; ++j) {
+        history[j] = 0;
+    }
+    window = 0;
+    cache.clear();
+    cachedBlock = static_cast<size_t>(-1);
+}
+
+// 0: exact prediction; 10: residual fits the window; 11: new window in 6 bits
+// (width - 1), then the residual
+void CompressedSeries::append(double value) {
+    size_t index = count % blockSize;
+    if (index == 0) {
+        blocks.push_back(bits);
+        window = 0;
+    }
+    uint64_t current = toBits(value);
+    uint64_t z = zigzag(static_cast<int64_t>(current - predict(history, index)));
+
+    if (z == 0) {
+        putBits(words, bits, 0, 1);
+    }
+    else {
+        int width = significantBits(z);
+        // a new window costs 6 bits, so it is only sent to grow or to shrink by more
+        if (width <= window && window - width <= 6) {
+            putBits(words, bits, 2, 2);
+        }
+        else {
+            putBits(words, bits, 3, 2);
+            putBits(words, bits, width - 1, 6);
+            window = width;
+        }
+        putBits(words, bits, z, window);
+    }
+    push(history, current);
+    ++count;
+    if (cachedBlock == blocks.size() - 1) {
+        cachedBlock = static_cast<size_t>(-1);
+    }
+}
+
+void CompressedSeries::decodeBlock(size_t block, double* out, int* width) const {
+    size_t n = count - block * blockSize < blockSize ? count - block * blockSize : blockSize;
+    BitReader reader(words.data(), blocks[block]);
+    uint64_t h[order] = { 0 };
+    int w = 0;
+    size_t i = 0;
+    for (; i < n && i < static_cast<size_t>(order); ++i) {
+        uint64_t z = 0;
+        if (reader.bit()) {
+            if (reader.bit()) {
+                w = static_cast<int>(reader.get(6)) + 1;
+            }
+            z = reader.get(w);
+        }
+        uint64_t current = static_cast<uint64_t>(unzigzag(z)) + predict(h, i);
+        out[i] = fromBits(current);
+        push(h, current);
+    }
+
+    // full-order prediction with the history in registers
+    uint64_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4], h5 = h[5];
+    for (; i < n; ++i) {
+        uint64_t z = 0;
+        if (reader.bit()) {
+            if (reader.bit()) {
+                w = static_cast<int>(reader.get(6)) + 1;
+            }
+            z = reader.get(w);
+        }
+        uint64_t current = static_cast<uint64_t>(unzigzag(z)) + 6 * (h0 + h4) - 15 * (h1 + h3) + 20 * h2 - h5;
+        out[i] = fromBits(current);
+        h5 = h4;
+        h4 = h3;
+        h3 = h2;
+        h2 = h1;
+        h1 = h0;
+        h0 = current;
+    }
+    if (width) {
+        *width = w;
+    }
+}
+
+double CompressedSeries::at(size_t i) const {
+    size_t block = i / blockSize;
+    if (block != cachedBlock) {
+        cache.resize(blockSize);
+        decodeBlock(block, cache.data(), 0);
+        cachedBlock = block;
+    }
+    return cache[i % blockSize];
+}
+
+void CompressedSeries::decode(std::vector<double>& out) const {
+    out.resize(count);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        decodeBlock(b, out.data() + b * blockSize, 0);
+    }
+}
+
+void CompressedSeries::write(std::ostream& out) const {
+    uint64_t n = count, nbits = bits, nblocks = blocks.size(), nwords = words.size();
+    writeValue(out, n);
+    writeValue(out, nbits);
+    writeValue(out, nblocks);
+    writeValue(out, nwords);
+    out.write(reinterpret_cast<const char*>(blocks.data()), nblocks * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(words.data()), nwords * sizeof(uint64_t));
+}
+
+bool CompressedSeries::read(std::istream& in) {
+    uint64_t n, nbits, nblocks, nwords;
+    if (!readValue(in, n) || !readValue(in, nbits) || !readValue(in, nblocks) || !readValue(in, nwords)) {
+        return false;
+    }
+    if (nblocks != (n + blockSize - 1) / blockSize) {
+        corrupt("block count does not match the value count");
+    }
+    if (nwords != (nbits + 63) / 64) {
+        corrupt("word count does not match the bit count");
+    }
+    if (nbits < n || nbits / maxBitsPerValue > n) {
+        corrupt("bit count does not match the value count");
+    }
+    clear();
+    blocks.resize(nblocks);
+    words.resize(nwords);
+    if (!in.read(reinterpret_cast<char*>(blocks.data()), nblocks * sizeof(uint64_t)) ||
+        !in.read(reinterpret_cast<char*>(words.data()), nwords * sizeof(uint64_t))) {
+        clear();
+        return false;
+    }
+    // every block must start where the one before it ends, with room for its values
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        uint64_t begin = blocks[b];
+        uint64_t end = b + 1 < blocks.size() ? blocks[b + 1] : nbits;
+        uint64_t values = n - b * blockSize < blockSize ? n - b * blockSize : blockSize;
+        if ((b == 0 && begin != 0) || begin > end || end - begin < values || end - begin > maxBitsPerValue * values) {
+            clear();
+            std::ostringstream what;
+            what << "block " << b << " has bit offset " << begin << " out of range";
+            corrupt(what.str());
+        }
+    }
+    count = n;
+    bits = nbits;
+
+    // restore the encoder state so appending continues the last block
+    if (count > 0) {
+        std::vector<double> last(blockSize);
+        size_t inLast = (count - 1) % blockSize + 1;
+        decodeBlock(blocks.size() - 1, last.data(), &window);
+        for (size_t j = 0; j < inLast && j < static_cast<size_t>(order); ++j) {
+            history[j] = toBits(last[inLast - 1 - j]);
+        }
+    }
+    return true;
+}
+
+CompressedTrajectory::CompressedTrajectory() : deltat(0), t0(0) {}
+
+CompressedTrajectory::CompressedTrajectory(const Simulation& sim)
+    : deltat(sim.getDeltat()), t0(sim.getTimeView().empty() ? 0 : sim.getTimeView()[0]) {
+    TrajectoryView xs = sim.getXView();
+    TrajectoryView ys = sim.getYView();
+    TrajectoryView Hs = sim.getHView();
+    for (size_t i = 0; i < xs.size(); ++i) {
+        x.append(xs[i]);
+        y.append(ys[i]);
+        H.append(Hs[i]);
+    }
+}
+
+double CompressedTrajectory::valueAt(const CompressedSeries& series, double time) const {
+    int index = static_cast<int>((time - t0) / deltat);
+    if (index >= 0 && static_cast<size_t>(index) < series.size()) {
+        return series.at(index);
+    }
+    else {
+        return -1;
+    }
+}
+
+double CompressedTrajectory::getXAtTime(double time) const {
+    return valueAt(x, time);
+}
+
+double CompressedTrajectory::getYAtTime(double time) const {
+    return valueAt(y, time);
+}
+
+double CompressedTrajectory::getHAtTime(double time) const {
+    return valueAt(H, time);
+}
+
+bool CompressedTrajectory::save(const std::string& filename) const {
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    file.write("LVZ1", 4);
+    writeValue(file, deltat);
+    writeValue(file, t0);
+    x.write(file);
+    y.write(file);
+    H.write(file);
+    return static_cast<bool>(file);
+}
+
+bool CompressedTrajectory::load(const std::string& filename) {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    char magic[4];
+    if (!file.read(magic, 4) || std::memcmp(magic, "LVZ1", 4) != 0) {
+        return false;
+    }
+    if (!readValue(file, deltat) || !readValue(file, t0) || !x.read(file) || !y.read(file) || !H.read(file)) {
+        return false;
+    }
+    if (x.size() != y.size() || x.size() != H.size()) {
+        throw std::runtime_error("CompressedTrajectory::load: series of different lengths in " + filename);
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef COMPRESSED_HPP
+#define COMPRESSED_HPP
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class Simulation;
+
+// Lossless compressed series of doubles. Each value is predicted by
+// polynomial extrapolation of the ones before it, done on their bit patterns
+// as integers so encoder and decoder agree exactly on every build; the
+// residual is zigzag coded and stored Gorilla style, with a two-bit control
+// code and its significant bits inside a window that is only resent when it
+// grows. Values are coded in blocks of blockSize that restart the prediction,
+// so a single value is read by decoding one block.
+class CompressedSeries {
+public:
+    static const size_t blockSize = 1024;
+    static const int order = 6;  // values the prediction looks back at
+
+    CompressedSeries();
+
+    void append(double value);
+    void clear();
+
+    size_t size() const { return count; }
+    // decodes the block holding i, or reuses the last one decoded (not thread safe)
+    double at(size_t i) const;
+    void decode(std::vector<double>& out) const;
+
+    size_t compressedBytes() const { return (words.size() + blocks.size()) * sizeof(uint64_t); }
+
+    // read returns false if the stream ends early and throws
+    // std::runtime_error if its counts or block offsets disagree
+    void write(std::ostream& out) const;
+    bool read(std::istream& in);
+
+private:
+    // width, if given, receives the window in force at the end of the block
+    void decodeBlock(size_t block, double* out, int* width) const;
+
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> blocks;  // first bit of each block
+    uint64_t bits;
+    size_t count;
+
+    // encoder state: latest values first, and the current window
+    uint64_t history[order];
+    int window;
+
+    mutable std::vector<double> cache;
+    mutable size_t cachedBlock;
+};
+
+// x, y and H of a finished run held as CompressedSeries; time is implicit
+// since samples are deltat apart. Saved files start with "LVZ1" and are in
+// the byte order of the machine that wrote them.
+class CompressedTrajectory {
+public:
+    CompressedTrajectory();
+    explicit CompressedTrajectory(const Simulation& sim);
+
+    size_t size() const { return x.size(); }
+    double getDeltat() const { return deltat; }
+
+    // same indexing as Simulation: -1 outside the run
+    double getXAtTime(double time) const;
+    double getYAtTime(double time) const;
+    double getHAtTime(double time) const;
+
+    const CompressedSeries& getXSeries() const { return x; }
+    const CompressedSeries& getYSeries() const { return y; }
+    const CompressedSeries& getHSeries() const { return H; }
+
+    size_t compressedBytes() const { return x.compressedBytes() + y.compressedBytes() + H.compressedBytes(); }
+
+    bool save(const std::string& filename) const;
+    // throws std::runtime_error for a corrupt file, see CompressedSeries::read
+    bool load(const std::string& filename);
+
+private:
+    double valueAt(const CompressedSeries& series, double time) const;
+
+    double deltat, t0;
+    CompressedSeries x, y, H;
+};
+
+#endif // COMPRESSED_HPP
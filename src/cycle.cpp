@@ -0,0 +1,119 @@
+#include "cycle.hpp"
+#include <cmath>
+
+// In u = ln(x/x*), v = ln(y/y*) the orbit is D*phi(u) + A*phi(v) = E with
+// phi(s) = e^s - 1 - s. Points of the orbit are found along rays of the
+// scaled plane (sqrt(D)*u, sqrt(A)*v) and the period is the integral of
+// dtheta / (dtheta/dt), a smooth periodic integrand for which the trapezoid
+// rule converges exponentially.
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+double phi(double s) {
+    return std::expm1(s) - s;
+}
+
+// Root of D*phi(r*cu) + A*phi(r*cv) = E for r > 0.
+double levelRadius(double A, double D, double E, double cu, double cv) {
+    double lo = 0, hi = std::sqrt(2 * E);
+    while (D * phi(hi * cu) + A * phi(hi * cv) < E) {
+        lo = hi;
+        hi *= 2;
+    }
+    double r = 0.5 * (lo + hi);
+    for (int i = 0; i < 100; ++i) {
+        double f = D * phi(r * cu) + A * phi(r * cv) - E;
+        if (f > 0) {
+            hi = r;
+        }
+        else {
+            lo = r;
+        }
+        double slope = D * cu * std::expm1(r * cu) + A * cv * std::expm1(r * cv);
+        double next = r - f / slope;
+        if (!(next > lo && next < hi)) {
+            next = 0.5 * (lo + hi);
+        }
+        if (std::fabs(next - r) <= 1e-15 * r) {
+            return next;
+        }
+        r = next;
+    }
+    return r;
+}
+
+// Solution of c*phi(s) = E with the sign of the given direction.
+double phiRoot(double c, double E, double direction) {
+    return direction * levelRadius(0, c, E, direction, 0);
+}
+
+struct Quadrature {
+    double period, xSum, ySum;
+};
+
+Quadrature integrate(double A, double D, double E, double xs, double ys, int nodes) {
+    Quadrature q = { 0, 0, 0 };
+    double sqD = std::sqrt(D), sqA = std::sqrt(A);
+    double h = 2 * PI / nodes;
+    for (int k = 0; k < nodes; ++k) {
+        double theta = k * h;
+        double c = std::cos(theta), s = std::sin(theta);
+        double r = levelRadius(A, D, E, c / sqD, s / sqA);
+        double u = r * c / sqD, v = r * s / sqA;
+        // dtheta/dt = (p q' - q p') / r^2 with p = sqrt(D) u, q = sqrt(A) v
+        double dp = sqD * A * -std::expm1(v);
+        double dq = sqA * D * std::expm1(u);
+        double rate = (r * c * dq - r * s * dp) / (r * r);
+        double dt = h / rate;
+        q.period += dt;
+        q.xSum += xs * std::exp(u) * dt;
+        q.ySum += ys * std::exp(v) * dt;
+    }
+    return q;
+}
+
+}
+
+CycleStatistics computeCycleStatistics(double A, double B, double C, double D, double x0, double y0) {
+    CycleStatistics stats = { -1, -1, -1, -1, -1, -1, -1, -1 };
+    if (!(A > 0 && B > 0 && C > 0 && D > 0 && x0 > 0 && y0 > 0)) {
+        return stats;
+    }
+
+    double xs = D / C, ys = A / B;
+    stats.H = -D * std::log(x0) + C * x0 + B * y0 - A * std::log(y0);
+    double E = D * phi(std::log(x0 / xs)) + A * phi(std::log(y0 / ys));
+
+    if (!(E > 1e-300)) {
+        stats.period = 2 * PI / std::sqrt(A * D);
+        stats.xMin = stats.xMax = stats.xMean = xs;
+        stats.yMin = stats.yMax = stats.yMean = ys;
+        return stats;
+    }
+
+    // x is extremal on y = y*, y on x = x*
+    stats.xMin = xs * std::exp(phiRoot(D, E, -1));
+    stats.xMax = xs * std::exp(phiRoot(D, E, 1));
+    stats.yMin = ys * std::exp(phiRoot(A, E, -1));
+    stats.yMax = ys * std::exp(phiRoot(A, E, 1));
+
+    // double the nodes until the period stops changing
+    int nodes = 64;
+    Quadrature q = integrate(A, D, E, xs, ys, nodes);
+    while (nodes < (1 << 20)) {
+        nodes *= 2;
+        Quadrature finer = integrate(A, D, E, xs, ys, nodes);
+        bool converged = std::fabs(finer.period - q.period) <= 1e-13 * finer.period;
+        q = finer;
+        if (converged) {
+            break;
+        }
+    }
+
+    stats.period = q.period;
+    stats.xMean = q.xSum / q.period;
+    stats.yMean = q.ySum / q.period;
+    return stats;
+}
@@ -0,0 +1,17 @@
+#ifndef CYCLE_HPP
+#define CYCLE_HPP
+
+// Statistics of the closed Lotka-Volterra orbit through (x0, y0), computed from
+// the level set of H without time stepping. Fields are -1 when the inputs are
+// not positive.
+struct CycleStatistics {
+    double H;
+    double period;
+    double xMin, xMax;
+    double yMin, yMax;
+    double xMean, yMean;  // time averages over one period
+};
+
+CycleStatistics computeCycleStatistics(double A, double B, double C, double D, double x0, double y0);
+
+#endif // CYCLE_HPP
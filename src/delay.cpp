@@ -0,0 +1,60 @@
+#include "delay.hpp"
+#include <cmath>
+
+Lag::Lag(double delay, double deltat) {
+    double whole = std::floor(delay / deltat);
+    fraction = delay / deltat - whole;
+    // delays within rounding of a grid point are taken as on the grid
+    if (fraction < 1e-9) {
+        fraction = 0;
+    }
+    else if (fraction > 1 - 1e-9) {
+        fraction = 0;
+        whole += 1;
+    }
+    steps = whole > 0 ? static_cast<size_t>(whole) : 0;
+}
+
+DelayHistory::DelayHistory(double maxDelay, double deltat, double x0, double y0) : head(0) {
+    Lag longest(maxDelay, deltat);
+    size_t size = 2;
+    while (size < longest.steps + 2) {
+        size *= 2;
+    }
+    xs.assign(size, x0);
+    ys.assign(size, y0);
+    mask = size - 1;
+}
+
+DelaySimulation::DelaySimulation(double x0, double y0, double A, double B, double C, double D, double deltat,
+                                 double tau, double preyDelay, double K)
+    : x(x0), y(y0), A(A), B(B), C(C), D(D), deltat(deltat), K(K), xFloor(1e-6 * D / C), yFloor(1e-6 * A / B),
+      predatorLag(tau, deltat), preyLag(preyDelay, deltat),
+      predatorDelayed(predatorLag.steps > 0 || predatorLag.fraction > 0),
+      preyDelayed(K > 0 && (preyLag.steps > 0 || preyLag.fraction > 0)),
+      history(tau > preyDelay ? tau : preyDelay, deltat, x0, y0), steps(0), initialObserved(false) {}
+
+void DelaySimulation::runSimulation(double totalTime) {
+    int n = static_cast<int>(totalTime / deltat);
+    // only the first run sends t = 0, even if it took no steps
+    if (!initialObserved) {
+        for (size_t k = 0; k < observers.size(); ++k) {
+            observers[k]->observe(0, x, y);
+        }
+        initialObserved = true;
+    }
+    if (observers.empty()) {
+        for (int i = 0; i < n; ++i) {
+            evolve();
+        }
+        steps += n;
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        evolve();
+        ++steps;
+        for (size_t k = 0; k < observers.size(); ++k) {
+            observers[k]->observe(steps * deltat, x, y);
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef DELAY_HPP
+#define DELAY_HPP
+
+#include "header.hpp"
+#include <cstddef>
+#include <vector>
+
+// Delay split into whole steps and the fraction of a step left over.
+struct Lag {
+    size_t steps;
+    double fraction;
+
+    Lag(double delay, double deltat);
+};
+
+// The last samples of (x, y), deltat apart, in a ring buffer sized for the
+// longest delay. Before the first push it holds the initial state, i.e. the
+// history for t <= 0 is constant.
+class DelayHistory {
+public:
+    DelayHistory(double maxDelay, double deltat, double x0, double y0);
+
+    void push(double x, double y) {
+        head = (head + 1) & mask;
+        xs[head] = x;
+        ys[head] = y;
+    }
+
+    // the state lag.steps + lag.fraction steps before the newest sample,
+    // linearly interpolated between the two samples around it
+    void lagged(const Lag& lag, double& x, double& y) const {
+        size_t i = (head - lag.steps) & mask;
+        x = xs[i];
+        y = ys[i];
+        if (lag.fraction > 0) {
+            size_t j = (i - 1) & mask;
+            x += lag.fraction * (xs[j] - x);
+            y += lag.fraction * (ys[j] - y);
+        }
+    }
+
+    size_t capacity() const { return xs.size(); }
+
+private:
+    std::vector<double> xs, ys;
+    size_t head, mask;
+};
+
+// Predator-prey model with a maturation delay tau for predators and,
+// optionally, a delayed logistic limit on prey:
+//   x' = A x (1 - x(t - preyDelay) / K) - B x y
+//   y' = C x(t - tau) y(t - tau) - D y
+// K = 0 leaves prey growth unlimited; tau = 0 and K = 0 give Simulation's
+// model. Stepped with Euler like Simulation; observers see every sample.
+class DelaySimulation {
+public:
+    DelaySimulation(double x0, double y0, double A, double B, double C, double D, double deltat, double tau,
+                    double preyDelay = 0, double K = 0);
+
+    void evolve() {
+        // a zero lag reads the state itself rather than the sample just stored
+        double xLag = x, yLag = y, xPrey = x, yPrey = y;
+        if (predatorDelayed) {
+            history.lagged(predatorLag, xLag, yLag);
+        }
+        if (preyDelayed) {
+            history.lagged(preyLag, xPrey, yPrey);
+        }
+        double growth = K > 0 ? A * (1 - xPrey / K) : A;
+        double newX = x + (growth - B * y) * x * deltat;
+        double newY = y + (C * xLag * yLag - D * y) * deltat;
+        x = newX > 0 ? newX : xFloor;
+        y = newY > 0 ? newY : yFloor;
+        history.push(x, y);
+    }
+
+    void runSimulation(double totalTime);
+    void addObserver(SimulationObserver* observer) { observers.push_back(observer); }
+
+    double getX() const { return x; }
+    double getY() const { return y; }
+    double getTime() const { return steps * deltat; }
+    const DelayHistory& getHistory() const { return history; }
+
+private:
+    double x, y, A, B, C, D, deltat, K;
+    double xFloor, yFloor;  // Simulation's: 1e-6 of the equilibrium (D / C, A / B)
+    Lag predatorLag, preyLag;
+    bool predatorDelayed, preyDelayed;
+    DelayHistory history;
+    long steps;
+    std::vector<SimulationObserver*> observers;
+    bool initialObserved;  // the t = 0 sample has been sent to the observers
+};
+
+#endif // DELAY_HPP
@@ -0,0 +1,92 @@
+#include "downsample.hpp"
+#include <cmath>
+
+namespace {
+
+void largestTriangle(const double* t, const double* v, size_t n, size_t target,
+                     std::vector<double>& outT, std::vector<double>& outV) {
+    double every = static_cast<double>(n - 2) / (target - 2);
+    size_t a = 0;
+    outT.push_back(t[0]);
+    outV.push_back(v[0]);
+
+    for (size_t bucket = 0; bucket < target - 2; ++bucket) {
+        // average of the next bucket is the third vertex
+        size_t nextStart = static_cast<size_t>((bucket + 1) * every) + 1;
+        size_t nextEnd = static_cast<size_t>((bucket + 2) * every) + 1;
+        if (nextEnd > n) {
+            nextEnd = n;
+        }
+        double avgT = 0, avgV = 0;
+        for (size_t i = nextStart; i < nextEnd; ++i) {
+            avgT += t[i];
+            avgV += v[i];
+        }
+        size_t count = nextEnd > nextStart ? nextEnd - nextStart : 1;
+        avgT /= count;
+        avgV /= count;
+
+        size_t start = static_cast<size_t>(bucket * every) + 1;
+        size_t end = static_cast<size_t>((bucket + 1) * every) + 1;
+        double bestArea = -1;
+        size_t best = start;
+        for (size_t i = start; i < end; ++i) {
+            double area = std::fabs((t[a] - avgT) * (v[i] - v[a]) - (t[a] - t[i]) * (avgV - v[a]));
+            if (area > bestArea) {
+                bestArea = area;
+                best = i;
+            }
+        }
+        outT.push_back(t[best]);
+        outV.push_back(v[best]);
+        a = best;
+    }
+
+    outT.push_back(t[n - 1]);
+    outV.push_back(v[n - 1]);
+}
+
+void minMax(const double* t, const double* v, size_t n, size_t target,
+            std::vector<double>& outT, std::vector<double>& outV) {
+    size_t buckets = target / 2 > 0 ? target / 2 : 1;
+    double every = static_cast<double>(n) / buckets;
+
+    for (size_t bucket = 0; bucket < buckets; ++bucket) {
+        size_t start = static_cast<size_t>(bucket * every);
+        size_t end = bucket + 1 == buckets ? n : static_cast<size_t>((bucket + 1) * every);
+        size_t lo = start, hi = start;
+        for (size_t i = start + 1; i < end; ++i) {
+            if (v[i] < v[lo]) lo = i;
+            if (v[i] > v[hi]) hi = i;
+        }
+        size_t first = lo < hi ? lo : hi;
+        size_t second = lo < hi ? hi : lo;
+        outT.push_back(t[first]);
+        outV.push_back(v[first]);
+        if (second != first) {
+            outT.push_back(t[second]);
+            outV.push_back(v[second]);
+        }
+    }
+}
+
+}
+
+void downsample(const double* t, const double* v, size_t n, size_t target,
+                DownsampleMode mode, std::vector<double>& outT, std::vector<double>& outV) {
+    outT.clear();
+    outV.clear();
+    if (target == 0 || n <= target || target < 3) {
+        outT.assign(t, t + n);
+        outV.assign(v, v + n);
+        return;
+    }
+    outT.reserve(target);
+    outV.reserve(target);
+    if (mode == LargestTriangle) {
+        largestTriangle(t, v, n, target, outT, outV);
+    }
+    else {
+        minMax(t, v, n, target, outT, outV);
+    }
+}
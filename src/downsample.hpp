@@ -0,0 +1,22 @@
+#ifndef DOWNSAMPLE_HPP
+#define DOWNSAMPLE_HPP
+
+#include <cstddef>
+#include <vector>
+
+enum DownsampleMode { LargestTriangle, MinMax };
+
+// Reduces the series (t, v) to about target points that still look the same
+// when drawn. LargestTriangle keeps first, last and per bucket the point
+// spanning the largest triangle with its neighbours (LTTB); MinMax keeps the
+// extremes of each of target/2 buckets so no peak is lost. Series with at
+// most target points, or a target below 3, are copied unchanged.
+void downsample(const double* t, const double* v, size_t n, size_t target,
+                DownsampleMode mode, std::vector<double>& outT, std::vector<double>& outV);
+
+inline void downsample(const std::vector<double>& t, const std::vector<double>& v, size_t target,
+                       DownsampleMode mode, std::vector<double>& outT, std::vector<double>& outV) {
+    downsample(t.data(), v.data(), t.size(), target, mode, outT, outV);
+}
+
+#endif // DOWNSAMPLE_HPP
@@ -0,0 +1,97 @@
+#ifndef DUAL_HPP
+#define DUAL_HPP
+
+#include <cmath>
+#include <ostream>
+
+// Forward-mode dual number carrying N directional derivatives. The fixed-size
+// gradient loops are unrolled and vectorised by the compiler, so all N
+// directions are propagated in one pass.
+template <int N>
+class Dual {
+public:
+    double value;
+    double grad[N];
+
+    Dual() : value(0) { zero(); }
+    Dual(double v) : value(v) { zero(); }
+
+    // independent variable number i
+    static Dual variable(double v, int i) {
+        Dual d(v);
+        d.grad[i] = 1;
+        return d;
+    }
+
+    Dual& operator+=(const Dual& o) {
+        value += o.value;
+        for (int i = 0; i < N; ++i) grad[i] += o.grad[i];
+        return *this;
+    }
+    Dual& operator-=(const Dual& o) {
+        value -= o.value;
+        for (int i = 0; i < N; ++i) grad[i] -= o.grad[i];
+        return *this;
+    }
+    Dual& operator*=(const Dual& o) {
+        for (int i = 0; i < N; ++i) grad[i] = grad[i] * o.value + value * o.grad[i];
+        value *= o.value;
+        return *this;
+    }
+    Dual& operator/=(const Dual& o) {
+        double inv = 1 / o.value;
+        double q = value * inv;
+        for (int i = 0; i < N; ++i) grad[i] = (grad[i] - q * o.grad[i]) * inv;
+        value = q;
+        return *this;
+    }
+
+private:
+    void zero() {
+        for (int i = 0; i < N; ++i) grad[i] = 0;
+    }
+};
+
+template <int N> Dual<N> operator+(Dual<N> a, const Dual<N>& b) { return a += b; }
+template <int N> Dual<N> operator-(Dual<N> a, const Dual<N>& b) { return a -= b; }
+template <int N> Dual<N> operator*(Dual<N> a, const Dual<N>& b) { return a *= b; }
+template <int N> Dual<N> operator/(Dual<N> a, const Dual<N>& b) { return a /= b; }
+template <int N> Dual<N> operator+(Dual<N> a, double b) { a.value += b; return a; }
+template <int N> Dual<N> operator+(double a, Dual<N> b) { b.value += a; return b; }
+template <int N> Dual<N> operator-(Dual<N> a, double b) { a.value -= b; return a; }
+template <int N> Dual<N> operator-(double a, const Dual<N>& b) { return Dual<N>(a) -= b; }
+
+template <int N> Dual<N> operator*(Dual<N> a, double b) {
+    a.value *= b;
+    for (int i = 0; i < N; ++i) a.grad[i] *= b;
+    return a;
+}
+template <int N> Dual<N> operator*(double a, const Dual<N>& b) { return b * a; }
+template <int N> Dual<N> operator/(const Dual<N>& a, double b) { return a * (1 / b); }
+template <int N> Dual<N> operator/(double a, const Dual<N>& b) { return Dual<N>(a) /= b; }
+
+template <int N> Dual<N> operator-(const Dual<N>& a) { return a * -1.0; }
+
+template <int N> bool operator>(const Dual<N>& a, double b) { return a.value > b; }
+template <int N> bool operator<(const Dual<N>& a, double b) { return a.value < b; }
+
+template <int N> Dual<N> log(const Dual<N>& a) {
+    Dual<N> r(std::log(a.value));
+    double inv = 1 / a.value;
+    for (int i = 0; i < N; ++i) r.grad[i] = a.grad[i] * inv;
+    return r;
+}
+
+template <int N> Dual<N> exp(const Dual<N>& a) {
+    Dual<N> r(std::exp(a.value));
+    for (int i = 0; i < N; ++i) r.grad[i] = a.grad[i] * r.value;
+    return r;
+}
+
+template <int N> Dual<N> scalarLog(const Dual<N>& a) { return log(a); }
+
+template <int N> std::ostream& operator<<(std::ostream& os, const Dual<N>& a) {
+    return os << a.value;
+}
+
+#endif // DUAL_HPP
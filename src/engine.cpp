@@ -0,0 +1,40 @@
+#include "engine.hpp"
+
+template <typename T>
+EngineResult<T> runEngine(T x0, T y0, T A, T B, T C, T D, T deltat, long steps, long auditEvery) {
+    LotkaVolterra<T> model(x0, y0, A, B, C, D, deltat);
+    EngineResult<T> result;
+    result.H0 = model.calculateH(model.getX(), model.getY());
+    result.maxDrift = 0;
+    result.steps = steps;
+
+    long audit = auditEvery > 0 ? auditEvery : steps;
+    for (long done = 0; done < steps;) {
+        long n = steps - done < audit ? steps - done : audit;
+        for (long i = 0; i < n; ++i) {
+            model.evolve();
+        }
+        done += n;
+        T drift = model.calculateH(model.getX(), model.getY()) - result.H0;
+        if (drift < 0) {
+            drift = -drift;
+        }
+        if (drift > result.maxDrift) {
+            result.maxDrift = drift;
+        }
+    }
+
+    result.x = model.getX();
+    result.y = model.getY();
+    result.H = model.calculateH(result.x, result.y);
+    return result;
+}
+
+template EngineResult<float> runEngine(float, float, float, float, float, float, float, long, long);
+template EngineResult<double> runEngine(double, double, double, double, double, double, double, long, long);
+template EngineResult<long double> runEngine(long double, long double, long double, long double, long double,
+                                             long double, long double, long, long);
+#ifdef SIM_HAVE_FLOAT128
+template EngineResult<__float128> runEngine(__float128, __float128, __float128, __float128, __float128,
+                                            __float128, __float128, long, long);
+#endif
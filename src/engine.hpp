@@ -0,0 +1,20 @@
+#ifndef ENGINE_HPP
+#define ENGINE_HPP
+
+#include "lotka_volterra.hpp"
+
+template <typename T>
+struct EngineResult {
+    T x, y;
+    T H0, H;       // H at the start and at the end
+    T maxDrift;    // largest |H - H0| seen at the audited steps
+    long steps;
+};
+
+// Runs steps Euler steps of LotkaVolterra<T> without storing the trajectory,
+// auditing H every auditEvery steps (0: only at the end). Instantiated for
+// float, double, long double and, where the compiler has it, __float128.
+template <typename T>
+EngineResult<T> runEngine(T x0, T y0, T A, T B, T C, T D, T deltat, long steps, long auditEvery = 1);
+
+#endif // ENGINE_HPP
@@ -0,0 +1,158 @@
+#include "ensemble.hpp"
+#include "vectorize.hpp"
+#include <cmath>
+
+namespace {
+
+const size_t blockSize = ensembleBlockSize;
+
+template <typename T>
+inline T clampRel(T v) {
+    return v > 0 ? v : T(1e-6);
+}
+
+// LotkaVolterra::calculateH
+double memberH(const EnsembleMember& m, double x, double y) {
+    return -m.D * std::log(x) + m.C * x + m.B * y - m.A * std::log(y);
+}
+
+}
+
+Ensemble::Ensemble(const std::vector<EnsembleMember>& members, double deltat, EnsemblePrecision precision,
+                   long resyncEvery)
+    : members(members), deltat(deltat), precision(precision), resyncEvery(resyncEvery > 0 ? resyncEvery : 1),
+      steps(0) {
+    size_t n = members.size();
+    H0.resize(n);
+    xd.resize(n);
+    yd.resize(n);
+    xf.resize(n);
+    yf.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const EnsembleMember& m = members[i];
+        H0[i] = memberH(m, m.x0, m.y0);
+        xd[i] = m.x0 * m.C / m.D;
+        yd[i] = m.y0 * m.B / m.A;
+        xf[i] = static_cast<float>(xd[i]);
+        yf[i] = static_cast<float>(yd[i]);
+    }
+}
+
+// Same update as LotkaVolterra::evolve: in relative coordinates B * e2_y is A
+// and C * e2_x is D, so each member needs only A * deltat and D * deltat.
+template <typename T>
+void Ensemble::runBlock(size_t begin, size_t end, long n, std::vector<T>& x, std::vector<T>& y) {
+    T a[blockSize], d[blockSize];
+    T* xs = &x[begin];
+    T* ys = &y[begin];
+    size_t count = end - begin;
+    for (size_t i = 0; i < count; ++i) {
+        const EnsembleMember& m = members[begin + i];
+        a[i] = static_cast<T>(m.A * deltat);
+        d[i] = static_cast<T>(m.D * deltat);
+    }
+    for (long s = 0; s < n; ++s) {
+        SIM_IVDEP
+        for (size_t i = 0; i < count; ++i) {
+            T xi = xs[i], yi = ys[i];
+            xs[i] = clampRel(xi + a[i] * (1 - yi) * xi);
+            ys[i] = clampRel(yi + d[i] * (xi - 1) * yi);
+        }
+    }
+}
+
+// Rounding the increments to float costs little: they are scaled by deltat.
+// What float cannot do is add them to the state, whose ulp is larger than
+// the increment's; adding them to the offset instead loses only the ulp of a
+// sum over resyncEvery steps. Per step the loop does no more work than the
+// float run, and a running minimum replaces the clamp.
+void Ensemble::runMixedBlock(size_t begin, size_t end, long n) {
+    float a[blockSize], d[blockSize], xs[blockSize], ys[blockSize], xo[blockSize], yo[blockSize], low[blockSize];
+    double* xb = &xd[begin];
+    double* yb = &yd[begin];
+    size_t count = end - begin;
+    for (size_t i = 0; i < count; ++i) {
+        const EnsembleMember& m = members[begin + i];
+        a[i] = static_cast<float>(m.A * deltat);
+        d[i] = static_cast<float>(m.D * deltat);
+    }
+    for (long done = 0; done < n;) {
+        long chunk = n - done < resyncEvery ? n - done : resyncEvery;
+        for (size_t i = 0; i < count; ++i) {
+            xs[i] = static_cast<float>(xb[i]);
+            ys[i] = static_cast<float>(yb[i]);
+            xo[i] = yo[i] = 0.0f;
+            low[i] = 1.0f;
+        }
+        for (long s = 0; s < chunk; ++s) {
+            SIM_IVDEP
+            for (size_t i = 0; i < count; ++i) {
+                float xi = xs[i] + xo[i], yi = ys[i] + yo[i];
+                xo[i] += a[i] * (1 - yi) * xi;
+                yo[i] += d[i] * (xi - 1) * yi;
+                float m = xi < yi ? xi : yi;
+                low[i] = low[i] < m ? low[i] : m;
+            }
+        }
+        // fold, leaving members that reached zero at the start of the chunk
+        int clamped = 0;
+        SIM_IVDEP
+        for (size_t i = 0; i < count; ++i) {
+            double x = xb[i] + xo[i], y = yb[i] + yo[i];
+            bool keep = (low[i] > 0) & (x > 0) & (y > 0);
+            xb[i] = keep ? x : xb[i];
+            yb[i] = keep ? y : yb[i];
+            low[i] = keep ? 1.0f : 0.0f;
+            clamped += keep ? 0 : 1;
+        }
+        // and redo the chunk for those in double with the clamp
+        for (size_t i = 0; clamped > 0 && i < count; ++i) {
+            if (low[i] > 0) {
+                continue;
+            }
+            const EnsembleMember& m = members[begin + i];
+            double ad = m.A * deltat, dd = m.D * deltat, x = xb[i], y = yb[i];
+            for (long s = 0; s < chunk; ++s) {
+                double nx = clampRel(x + ad * (1 - y) * x);
+                y = clampRel(y + dd * (x - 1) * y);
+                x = nx;
+            }
+            xb[i] = x;
+            yb[i] = y;
+            --clamped;
+        }
+        done += chunk;
+    }
+}
+
+void Ensemble::run(long n) {
+    for (size_t begin = 0; begin < members.size(); begin += blockSize) {
+        size_t end = begin + blockSize < members.size() ? begin + blockSize : members.size();
+        if (precision == EnsembleDouble) {
+            runBlock(begin, end, n, xd, yd);
+        }
+        else if (precision == EnsembleFloat) {
+            runBlock(begin, end, n, xf, yf);
+        }
+        else {
+            runMixedBlock(begin, end, n);
+        }
+    }
+    steps += n;
+}
+
+double Ensemble::getX(size_t i) const {
+    const EnsembleMember& m = members[i];
+    double rel = precision == EnsembleFloat ? xf[i] : xd[i];
+    return rel * m.D / m.C;
+}
+
+double Ensemble::getY(size_t i) const {
+    const EnsembleMember& m = members[i];
+    double rel = precision == EnsembleFloat ? yf[i] : yd[i];
+    return rel * m.A / m.B;
+}
+
+double Ensemble::getH(size_t i) const {
+    return memberH(members[i], getX(i), getY(i));
+}
@@ -0,0 +1,52 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include <cstddef>
+#include <vector>
+
+// How an ensemble carries its state. Mixed keeps the state in double but
+// steps it in float lanes: each increment is computed from a float copy of
+// the state and summed into a float offset, which stays small and is added to
+// the double state every resyncEvery steps. The float loop has no clamp; a
+// member that reaches zero within a chunk replays that chunk in double.
+enum EnsemblePrecision { EnsembleDouble, EnsembleFloat, EnsembleMixed };
+
+struct EnsembleMember {
+    double x0, y0, A, B, C, D;
+};
+
+// Many independent Lotka-Volterra runs with a shared time step, stored as
+// structure of arrays and stepped in cache-sized blocks so the inner loop over
+// members vectorises.
+class Ensemble {
+public:
+    Ensemble(const std::vector<EnsembleMember>& members, double deltat,
+             EnsemblePrecision precision = EnsembleMixed, long resyncEvery = 16);
+
+    void run(long steps);
+
+    size_t size() const { return members.size(); }
+    long getSteps() const { return steps; }
+    double getX(size_t i) const;
+    double getY(size_t i) const;
+    double getH(size_t i) const;
+    double getInitialH(size_t i) const { return H0[i]; }
+
+private:
+    template <typename T>
+    void runBlock(size_t begin, size_t end, long n, std::vector<T>& x, std::vector<T>& y);
+    void runMixedBlock(size_t begin, size_t end, long n);
+
+    std::vector<EnsembleMember> members;
+    double deltat;
+    EnsemblePrecision precision;
+    long resyncEvery;
+    long steps;
+    std::vector<double> H0;
+
+    // relative state: double for the double and mixed runs, float for the float run
+    std::vector<double> xd, yd;
+    std::vector<float> xf, yf;
+};
+
+#endif // ENSEMBLE_HPP
@@ -0,0 +1,207 @@
+#include "events.hpp"
+
+namespace {
+
+// Newton form of the quadratic through (t[0], f[0]), (t[1], f[1]), (t[2], f[2]).
+struct Quadratic {
+    double t0, t1, f0, f01, f012;
+
+    Quadratic(const double t[3], const double f[3]) : t0(t[0]), t1(t[1]), f0(f[0]) {
+        f01 = (f[1] - f[0]) / (t[1] - t[0]);
+        double f12 = (f[2] - f[1]) / (t[2] - t[1]);
+        f012 = (f12 - f01) / (t[2] - t[0]);
+    }
+
+    double value(double s) const {
+        return f0 + (s - t0) * (f01 + f012 * (s - t1));
+    }
+
+    double derivative(double s) const {
+        return f01 + f012 * (2 * s - t0 - t1);
+    }
+};
+
+double clamp(double s, double lo, double hi) {
+    return s < lo ? lo : (s > hi ? hi : s);
+}
+
+}
+
+EventDetector::EventDetector()
+    : recording(true), samples(0), preyMaxCount(0),
+      firstPreyMaxTime(0), lastPreyMaxTime(0), lastPeriod(-1),
+      preyMax(-1), preyMin(-1), predatorMax(-1), predatorMin(-1) {
+    for (int i = 0; i < 3; ++i) {
+        t[i] = xs[i] = ys[i] = 0;
+    }
+    for (int i = 0; i < 6; ++i) {
+        counts[i] = 0;
+    }
+}
+
+int EventDetector::addThreshold(Population population, double level) {
+    Threshold threshold = { population, level };
+    thresholds.push_back(threshold);
+    return static_cast<int>(thresholds.size()) - 1;
+}
+
+int EventDetector::addSection(double a, double b, double c, int direction) {
+    Section section = { a, b, c, direction };
+    sections.push_back(section);
+    return static_cast<int>(sections.size()) - 1;
+}
+
+void EventDetector::observe(double time, double x, double y) {
+    if (samples > 0 && time <= t[2]) {
+        return;
+    }
+    t[0] = t[1]; t[1] = t[2]; t[2] = time;
+    xs[0] = xs[1]; xs[1] = xs[2]; xs[2] = x;
+    ys[0] = ys[1]; ys[1] = ys[2]; ys[2] = y;
+    ++samples;
+    if (samples < 2) {
+        return;
+    }
+
+    if (samples >= 3) {
+        detectExtremum(Prey);
+        detectExtremum(Predator);
+    }
+
+    double f[3];
+    for (size_t k = 0; k < thresholds.size(); ++k) {
+        const double* v = thresholds[k].population == Prey ? xs : ys;
+        for (int i = 0; i < 3; ++i) {
+            f[i] = v[i] - thresholds[k].level;
+        }
+        detectCrossing(ThresholdCrossing, static_cast<int>(k), f, 0);
+    }
+    for (size_t k = 0; k < sections.size(); ++k) {
+        const Section& s = sections[k];
+        for (int i = 0; i < 3; ++i) {
+            f[i] = s.a * xs[i] + s.b * ys[i] - s.c;
+        }
+        detectCrossing(SectionHit, static_cast<int>(k), f, s.direction);
+    }
+}
+
+void EventDetector::detectExtremum(Population population) {
+    const double* f = population == Prey ? xs : ys;
+    double rise = f[1] - f[0];
+    double fall = f[2] - f[1];
+    bool isMax = rise > 0 && fall <= 0;
+    bool isMin = rise < 0 && fall >= 0;
+    if (!isMax && !isMin) {
+        return;
+    }
+
+    // vertex of the interpolating parabola
+    Quadratic q(t, f);
+    double s = t[1];
+    if (q.f012 != 0) {
+        s = clamp(0.5 * (t[0] + t[1]) - q.f01 / (2 * q.f012), t[0], t[2]);
+    }
+    double value = q.value(s);
+
+    if (population == Prey) {
+        if (isMax) {
+            preyMax = value;
+            if (preyMaxCount == 0) {
+                firstPreyMaxTime = s;
+            }
+            else {
+                lastPeriod = s - lastPreyMaxTime;
+            }
+            lastPreyMaxTime = s;
+            ++preyMaxCount;
+        }
+        else {
+            preyMin = value;
+        }
+        emit(isMax ? PreyMaximum : PreyMinimum, -1, 0, s);
+    }
+    else {
+        if (isMax) {
+            predatorMax = value;
+        }
+        else {
+            predatorMin = value;
+        }
+        emit(isMax ? PredatorMaximum : PredatorMinimum, -1, 0, s);
+    }
+}
+
+void EventDetector::detectCrossing(EventType type, int id, const double f[3], int direction) {
+    int crossed = 0;
+    if (f[1] < 0 && f[2] >= 0) {
+        crossed = 1;
+    }
+    else if (f[1] >= 0 && f[2] < 0) {
+        crossed = -1;
+    }
+    if (crossed == 0 || (direction != 0 && direction != crossed)) {
+        return;
+    }
+
+    // linear guess, then Newton on the quadratic when three samples are available
+    double s = t[1] + (t[2] - t[1]) * f[1] / (f[1] - f[2]);
+    if (samples >= 3) {
+        Quadratic q(t, f);
+        for (int i = 0; i < 4; ++i) {
+            double slope = q.derivative(s);
+            if (slope == 0) {
+                break;
+            }
+            s = clamp(s - q.value(s) / slope, t[1], t[2]);
+        }
+    }
+    emit(type, id, crossed, s);
+}
+
+void EventDetector::emit(EventType type, int id, int direction, double time) {
+    ++counts[type];
+    if (!recording) {
+        return;
+    }
+
+    Event event = { type, id, direction, time, 0, 0 };
+    if (samples >= 3) {
+        event.x = Quadratic(t, xs).value(time);
+        event.y = Quadratic(t, ys).value(time);
+    }
+    else {
+        double w = (time - t[1]) / (t[2] - t[1]);
+        event.x = xs[1] + w * (xs[2] - xs[1]);
+        event.y = ys[1] + w * (ys[2] - ys[1]);
+    }
+    events.push_back(event);
+}
+
+int EventDetector::getEventCount(EventType type) const {
+    return counts[type];
+}
+
+double EventDetector::getPeriod() const {
+    if (preyMaxCount < 2) {
+        return -1;
+    }
+    return (lastPreyMaxTime - firstPreyMaxTime) / (preyMaxCount - 1);
+}
+
+double EventDetector::getLastPeriod() const {
+    return lastPeriod;
+}
+
+double EventDetector::getPreyAmplitude() const {
+    if (preyMax < 0 || preyMin < 0) {
+        return -1;
+    }
+    return 0.5 * (preyMax - preyMin);
+}
+
+double EventDetector::getPredatorAmplitude() const {
+    if (predatorMax < 0 || predatorMin < 0) {
+        return -1;
+    }
+    return 0.5 * (predatorMax - predatorMin);
+}
@@ -0,0 +1,85 @@
+#ifndef EVENTS_HPP
+#define EVENTS_HPP
+
+#include "header.hpp"
+#include <vector>
+
+enum Population { Prey, Predator };
+
+enum EventType {
+    PreyMaximum,
+    PreyMinimum,
+    PredatorMaximum,
+    PredatorMinimum,
+    ThresholdCrossing,
+    SectionHit
+};
+
+struct Event {
+    EventType type;
+    int id;         // threshold or section index, -1 for extrema
+    int direction;  // +1 upward crossing, -1 downward crossing
+    double time;
+    double x;
+    double y;
+};
+
+// Detects extrema, threshold crossings and Poincare-section hits while the
+// simulation runs. Only the last three samples are kept; event times are
+// refined on the quadratic through them, so no trajectory is needed.
+class EventDetector : public SimulationObserver {
+public:
+    EventDetector();
+
+    // level crossed by x (Prey) or y (Predator); returns the threshold id
+    int addThreshold(Population population, double level);
+    // line a*x + b*y = c crossed in the given direction (0 = both); returns the section id
+    int addSection(double a, double b, double c, int direction);
+
+    void observe(double t, double x, double y);
+
+    void setRecording(bool record) { recording = record; }
+    const std::vector<Event>& getEvents() const { return events; }
+    int getEventCount(EventType type) const;
+
+    double getPeriod() const;      // mean time between prey maxima, -1 if not measured yet
+    double getLastPeriod() const;
+    int getCycleCount() const { return preyMaxCount > 0 ? preyMaxCount - 1 : 0; }
+
+    double getPreyMax() const { return preyMax; }
+    double getPreyMin() const { return preyMin; }
+    double getPredatorMax() const { return predatorMax; }
+    double getPredatorMin() const { return predatorMin; }
+    double getPreyAmplitude() const;
+    double getPredatorAmplitude() const;
+
+private:
+    struct Threshold {
+        Population population;
+        double level;
+    };
+    struct Section {
+        double a, b, c;
+        int direction;
+    };
+
+    void detectExtremum(Population population);
+    void detectCrossing(EventType type, int id, const double f[3], int direction);
+    void emit(EventType type, int id, int direction, double time);
+
+    std::vector<Threshold> thresholds;
+    std::vector<Section> sections;
+    std::vector<Event> events;
+    bool recording;
+
+    // sliding window of the last three samples, oldest first
+    double t[3], xs[3], ys[3];
+    int samples;
+
+    int counts[6];
+    int preyMaxCount;
+    double firstPreyMaxTime, lastPreyMaxTime, lastPeriod;
+    double preyMax, preyMin, predatorMax, predatorMin;
+};
+
+#endif // EVENTS_HPP
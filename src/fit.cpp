@@ -0,0 +1,279 @@
+#include "fit.hpp"
+#include "dual.hpp"
+#include "lotka_volterra.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+std::vector<Observation> loadObservations(const std::string& filename) {
+    std::vector<Observation> observations;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream row(line);
+        Observation obs;
+        char comma1 = 0, comma2 = 0;
+        if (row >> obs.t >> comma1 >> obs.x >> comma2 >> obs.y && comma1 == ',' && comma2 == ',') {
+            observations.push_back(obs);
+        }
+    }
+    return observations;
+}
+
+namespace {
+
+const int P = 6;
+
+struct Problem {
+    const std::vector<Observation>* observations;
+    std::vector<long> stepIndex;  // step at which each observation is compared
+    double deltat;
+};
+
+typedef Dual<P> FitDual;  // derivatives with respect to A, B, C, D, x0, y0
+
+inline double valueOf(double v) {
+    return v;
+}
+
+inline double valueOf(const FitDual& v) {
+    return v.value;
+}
+
+inline double gradient(double, int) {
+    return 0;
+}
+
+inline double gradient(const FitDual& v, int j) {
+    return v.grad[j];
+}
+
+// Runs LotkaVolterra<T>, Simulation's update and clamp, from the parameters
+// in q (A, B, C, D, x0, y0) and fills the residuals. With T = FitDual
+// the state carries its derivatives; those of the residuals with respect to
+// log(p) go to jac, row-major with P columns.
+template <typename T>
+double run(const Problem& problem, const T q[P], const double p[P], std::vector<double>& res,
+           std::vector<double>* jac) {
+    const std::vector<Observation>& obs = *problem.observations;
+    LotkaVolterra<T> model(q[4], q[5], q[0], q[1], q[2], q[3], T(problem.deltat));
+
+    long step = 0;
+    double cost = 0;
+    for (size_t k = 0; k < obs.size(); ++k) {
+        for (; step < problem.stepIndex[k]; ++step) {
+            model.evolve();
+        }
+        T x = model.getX(), y = model.getY();
+        res[2 * k] = valueOf(x) - obs[k].x;
+        res[2 * k + 1] = valueOf(y) - obs[k].y;
+        cost += res[2 * k] * res[2 * k] + res[2 * k + 1] * res[2 * k + 1];
+        if (jac) {
+            for (int j = 0; j < P; ++j) {
+                (*jac)[(2 * k) * P + j] = gradient(x, j) * p[j];
+                (*jac)[(2 * k + 1) * P + j] = gradient(y, j) * p[j];
+            }
+        }
+    }
+    cost *= 0.5;
+    return std::isfinite(cost) ? cost : std::numeric_limits<double>::infinity();
+}
+
+// Residuals for parameters p and, with a non-null jac, their derivatives
+// with respect to log(p).
+double evaluate(const Problem& problem, const double p[P], std::vector<double>& res, std::vector<double>* jac) {
+    res.resize(2 * problem.observations->size());
+    if (!jac) {
+        return run(problem, p, p, res, 0);
+    }
+    jac->resize(res.size() * P);
+    FitDual q[P];
+    for (int j = 0; j < P; ++j) {
+        q[j] = FitDual::variable(p[j], j);
+    }
+    return run(problem, q, p, res, jac);
+}
+
+// Solves M d = b in place by Gaussian elimination with partial pivoting.
+bool solve(double M[P][P], double b[P], double d[P]) {
+    for (int c = 0; c < P; ++c) {
+        int pivot = c;
+        for (int r = c + 1; r < P; ++r) {
+            if (std::fabs(M[r][c]) > std::fabs(M[pivot][c])) {
+                pivot = r;
+            }
+        }
+        if (M[pivot][c] == 0) {
+            return false;
+        }
+        std::swap(M[c], M[pivot]);
+        std::swap(b[c], b[pivot]);
+        for (int r = c + 1; r < P; ++r) {
+            double f = M[r][c] / M[c][c];
+            for (int k = c; k < P; ++k) {
+                M[r][k] -= f * M[c][k];
+            }
+            b[r] -= f * b[c];
+        }
+    }
+    for (int c = P - 1; c >= 0; --c) {
+        double s = b[c];
+        for (int k = c + 1; k < P; ++k) {
+            s -= M[c][k] * d[k];
+        }
+        d[c] = s / M[c][c];
+    }
+    return true;
+}
+
+FitResult levenbergMarquardt(const Problem& problem, const FitParameters& start, int maxIterations) {
+    TRACE_SCOPE("fitStart");
+    FitResult result;
+    double p[P] = { start.A, start.B, start.C, start.D, start.x0, start.y0 };
+    double logp[P], trial[P];
+    for (int j = 0; j < P; ++j) {
+        logp[j] = std::log(p[j]);
+    }
+
+    std::vector<double> res, trialRes, jac;
+    double cost = evaluate(problem, p, res, &jac);
+    int simulations = 1;
+    double lambda = 1e-3;
+    bool converged = false;
+    int iteration = 0;
+
+    for (; iteration < maxIterations && std::isfinite(cost); ++iteration) {
+        double JtJ[P][P] = {}, g[P] = {};
+        for (size_t r = 0; r < res.size(); ++r) {
+            const double* row = &jac[r * P];
+            for (int i = 0; i < P; ++i) {
+                g[i] += row[i] * res[r];
+                for (int k = 0; k < P; ++k) {
+                    JtJ[i][k] += row[i] * row[k];
+                }
+            }
+        }
+
+        bool accepted = false;
+        double trialCost = cost, step = 0;
+        for (int attempt = 0; attempt < 12 && !accepted; ++attempt) {
+            double M[P][P], b[P], d[P];
+            for (int i = 0; i < P; ++i) {
+                for (int k = 0; k < P; ++k) {
+                    M[i][k] = JtJ[i][k];
+                }
+                M[i][i] += lambda * (JtJ[i][i] + 1e-12);
+                b[i] = -g[i];
+            }
+            if (!solve(M, b, d)) {
+                lambda *= 10;
+                continue;
+            }
+            step = 0;
+            for (int j = 0; j < P; ++j) {
+                trial[j] = std::exp(logp[j] + d[j]);
+                step = std::max(step, std::fabs(d[j]));
+            }
+            trialCost = evaluate(problem, trial, trialRes, 0);
+            ++simulations;
+            if (trialCost < cost) {
+                accepted = true;
+                lambda = std::max(lambda / 3, 1e-12);
+            }
+            else {
+                lambda *= 4;
+            }
+        }
+        if (!accepted) {
+            converged = true;
+            break;
+        }
+
+        double previous = cost;
+        std::copy(trial, trial + P, p);
+        for (int j = 0; j < P; ++j) {
+            logp[j] = std::log(p[j]);
+        }
+        cost = evaluate(problem, p, res, &jac);
+        ++simulations;
+        if (previous - cost <= 1e-12 * previous || step < 1e-10) {
+            converged = true;
+            ++iteration;
+            break;
+        }
+    }
+
+    FitParameters fitted = { p[0], p[1], p[2], p[3], p[4], p[5] };
+    result.parameters = fitted;
+    result.cost = cost;
+    result.iterations = iteration;
+    result.simulations = simulations;
+    result.converged = converged;
+    return result;
+}
+
+}
+
+FitResult fitParameters(const std::vector<Observation>& observations,
+                        const FitParameters& guess, const FitOptions& options) {
+    // parameters are fitted in log space
+    if (!(guess.A > 0 && guess.B > 0 && guess.C > 0 && guess.D > 0 && guess.x0 > 0 && guess.y0 > 0)) {
+        throw std::invalid_argument("fitParameters: every parameter of the guess must be positive");
+    }
+    std::vector<Observation> sorted(observations);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Observation& a, const Observation& b) { return a.t < b.t; });
+
+    Problem problem;
+    problem.observations = &sorted;
+    problem.deltat = options.deltat;
+    for (size_t k = 0; k < sorted.size(); ++k) {
+        problem.stepIndex.push_back(std::max(0L, std::lround(sorted[k].t / options.deltat)));
+    }
+
+    // starting points are drawn up front so the result does not depend on threads
+    int starts = std::max(1, options.starts);
+    std::vector<FitParameters> initial(starts, guess);
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<double> jitter(-options.spread, options.spread);
+    for (int s = 1; s < starts; ++s) {
+        FitParameters& q = initial[s];
+        q.A *= std::exp(jitter(rng));
+        q.B *= std::exp(jitter(rng));
+        q.C *= std::exp(jitter(rng));
+        q.D *= std::exp(jitter(rng));
+        q.x0 *= std::exp(jitter(rng));
+        q.y0 *= std::exp(jitter(rng));
+    }
+
+    std::vector<FitResult> results(starts);
+    int threads = std::max(1, std::min(options.threads, starts));
+    std::vector<std::thread> workers;
+    for (int w = 0; w < threads; ++w) {
+        workers.push_back(std::thread([&, w]() {
+            for (int s = w; s < starts; s += threads) {
+                results[s] = levenbergMarquardt(problem, initial[s], options.maxIterations);
+            }
+        }));
+    }
+    for (size_t w = 0; w < workers.size(); ++w) {
+        workers[w].join();
+    }
+
+    FitResult best = results[0];
+    int simulations = 0;
+    for (int s = 0; s < starts; ++s) {
+        simulations += results[s].simulations;
+        if (results[s].cost < best.cost) {
+            best = results[s];
+        }
+    }
+    best.simulations = simulations;
+    return best;
+}
@@ -0,0 +1,46 @@
+#ifndef FIT_HPP
+#define FIT_HPP
+
+#include <string>
+#include <vector>
+
+struct Observation {
+    double t, x, y;
+};
+
+// Reads "time,x,y[,...]" rows such as those written by saveResults.
+// Returns an empty vector if the file cannot be read.
+std::vector<Observation> loadObservations(const std::string& filename);
+
+struct FitParameters {
+    double A, B, C, D, x0, y0;
+};
+
+struct FitOptions {
+    double deltat;
+    int maxIterations;
+    int starts;         // independent starting points around the guess
+    int threads;
+    double spread;      // starts are drawn from guess * exp(U(-spread, spread))
+    unsigned seed;
+
+    FitOptions() : deltat(0.001), maxIterations(100), starts(1), threads(1), spread(0.5), seed(1) {}
+};
+
+struct FitResult {
+    FitParameters parameters;
+    double cost;        // 0.5 * sum of squared residuals in x and y
+    int iterations;
+    int simulations;    // model runs over all starts, counting a sensitivity run as one
+    bool converged;
+};
+
+// Levenberg-Marquardt fit of A, B, C, D, x0, y0 to the observations. The model
+// is Simulation's LotkaVolterra run over Dual<6> numbers, whose derivatives
+// give the Jacobian. Parameters are fitted in log space so they stay
+// positive; a guess with a parameter that is not positive throws
+// std::invalid_argument.
+FitResult fitParameters(const std::vector<Observation>& observations,
+                        const FitParameters& guess, const FitOptions& options = FitOptions());
+
+#endif // FIT_HPP
@@ -0,0 +1,40 @@
+#include "forcing.hpp"
+#include <cmath>
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+struct Seasonal {
+    double mean, amplitude, omega, phase;
+
+    double operator()(double t) const { return mean * (1 + amplitude * std::cos(omega * t + phase)); }
+};
+
+struct Constant {
+    double value;
+
+    double operator()(double) const { return value; }
+};
+
+}
+
+ForcingTable::ForcingTable(const std::function<double(double)>& f, double period, double deltat) : deltat(deltat) {
+    long steps = std::lround(period / deltat);
+    values.resize(steps > 0 ? static_cast<size_t>(steps) : 1);
+    for (size_t k = 0; k < values.size(); ++k) {
+        values[k] = f(k * deltat);
+    }
+}
+
+ForcingTable ForcingTable::seasonal(double mean, double amplitude, double period, double phase, double deltat) {
+    // one whole number of steps per period, so the table wraps without a jump
+    long steps = std::lround(period / deltat);
+    Seasonal f = { mean, amplitude, 2 * pi / ((steps > 0 ? steps : 1) * deltat), phase };
+    return ForcingTable(f, period, deltat);
+}
+
+ForcingTable ForcingTable::constant(double value, double deltat) {
+    Constant f = { value };
+    return ForcingTable(f, deltat, deltat);
+}
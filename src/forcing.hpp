@@ -0,0 +1,33 @@
+#ifndef FORCING_HPP
+#define FORCING_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// A periodic parameter sampled once per time step over one period, so a step
+// loop reads it instead of evaluating trig functions. The period is rounded to
+// a whole number of steps (getPeriod gives the one actually used); sample k
+// is the value at time k * deltat.
+class ForcingTable {
+public:
+    ForcingTable(const std::function<double(double)>& f, double period, double deltat);
+
+    // mean * (1 + amplitude * cos(2 pi t / period + phase))
+    static ForcingTable seasonal(double mean, double amplitude, double period, double phase, double deltat);
+    // constant value, period of one step
+    static ForcingTable constant(double value, double deltat);
+
+    size_t size() const { return values.size(); }
+    double getPeriod() const { return values.size() * deltat; }
+    double getDeltat() const { return deltat; }
+
+    double operator[](size_t step) const { return values[step]; }
+    double at(long step) const { return values[static_cast<size_t>(step % static_cast<long>(values.size()))]; }
+
+private:
+    std::vector<double> values;
+    double deltat;
+};
+
+#endif // FORCING_HPP
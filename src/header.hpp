@@ -3,16 +3,35 @@
 
 #include <vector>
 #include <string>
+#include "lotka_volterra.hpp"
+#include "downsample.hpp"
+#include "memory.hpp"
+
+// Receives every sample produced by runSimulation, in time order.
+class SimulationObserver {
+public:
+    virtual ~SimulationObserver() {}
+    virtual void observe(double t, double x, double y) = 0;
+};
 
 class Simulation {
 public:
-    Simulation(double x0, double y0, double A, double B, double C, double D, double deltat);
+    // trajectory storage comes from resource (e.g. a MonotonicArena), or from
+    // std::vector on the heap if null
+    Simulation(double x0, double y0, double A, double B, double C, double D, double deltat,
+               MemoryResource* resource = 0);
+
+    // starts over with new parameters, keeping the trajectory storage allocated
+    void reset(double x0, double y0, double A, double B, double C, double D, double deltat);
 
     void runSimulation(double totalTime);
+    void addObserver(SimulationObserver* observer);
     void saveResults(const std::string& filename) const;
-    void plotResultsWithGnuplot() const;
-    void plotHWithGnuplot() const;
+    // curves are downsampled to about maxPoints before being sent (0 sends every sample)
+    void plotResultsWithGnuplot(size_t maxPoints = 2000, DownsampleMode mode = LargestTriangle) const;
+    void plotHWithGnuplot(size_t maxPoints = 2000, DownsampleMode mode = LargestTriangle) const;
 
+    double getDeltat() const { return deltat; }
     double getX() const;
     double getY() const;
     double getH() const;
@@ -21,18 +40,34 @@ public:
     double getYAtTime(double time) const;
     double getHAtTime(double time) const;
 
-    const std::vector<double>& getXValues() const { return x_values; }
-    const std::vector<double>& getYValues() const { return y_values; }
-    const std::vector<double>& getHValues() const { return H_values; }
+    // The stored series of a heap-backed simulation. One built on a
+    // MemoryResource has no std::vector to return and throws std::logic_error:
+    // read it through the views below, which work for both.
+    const std::vector<double>& getXValues() const;
+    const std::vector<double>& getYValues() const;
+    const std::vector<double>& getHValues() const;
+    const std::vector<double>& getTimeValues() const;
+
+    TrajectoryView getXView() const;
+    TrajectoryView getYView() const;
+    TrajectoryView getHView() const;
+    TrajectoryView getTimeView() const;
 
     double calculateH(double x, double y) const; // Move this to public
+    // the integrator with its parameters, e.g. for observers that copy it
+    const LotkaVolterra<double>& getModel() const { return model; }
 
 private:
     void evolve();
 
-    double x_rel, y_rel, A, B, C, D, deltat;
-    double e2_x, e2_y;
+    double deltat;
+    LotkaVolterra<double> model;
+    MemoryResource* resource;
+    // exactly one set holds the run: the vectors when resource is null
     std::vector<double> x_values, y_values, H_values, time_values;
+    Trajectory x_stored, y_stored, H_stored, time_stored;
+    std::vector<SimulationObserver*> observers;
+    bool initialObserved;  // the t = 0 sample has been sent to the observers
 };
 
 #endif // HEADER_HPP
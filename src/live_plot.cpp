@@ -0,0 +1,122 @@
+#include "live_plot.hpp"
+#include <chrono>
+#include <memory>
+#include <gnuplot-iostream.h>
+
+namespace {
+
+class GnuplotSink : public LivePlotSink {
+public:
+    GnuplotSink() {
+        gp << "set title 'Prede e predatori in funzione del tempo'\n";
+        gp << "set xlabel 'Tempo'\n";
+        gp << "set ylabel 'Popolazione'\n";
+    }
+
+    void draw(const std::vector<double>& tx, const std::vector<double>& x, const std::vector<double>& ty,
+              const std::vector<double>& y) {
+        gp << "plot '-' binary" << gp.binFmt1d(boost::make_tuple(tx, x), "record") << "using 1:2 with lines notitle, "
+           << "'-' binary" << gp.binFmt1d(boost::make_tuple(ty, y), "record") << "using 1:2 with lines notitle\n";
+        gp.sendBinary1d(boost::make_tuple(tx, x));
+        gp.sendBinary1d(boost::make_tuple(ty, y));
+        gp.flush();
+    }
+
+private:
+    Gnuplot gp;
+};
+
+// keeps a growing curve bounded without losing its peaks
+void compact(std::vector<double>& t, std::vector<double>& v, size_t maxPoints) {
+    if (t.size() > 4 * maxPoints) {
+        std::vector<double> ct, cv;
+        downsample(t, v, 2 * maxPoints, MinMax, ct, cv);
+        t.swap(ct);
+        v.swap(cv);
+    }
+}
+
+}
+
+LivePlotter::LivePlotter(size_t decimation, double framesPerSecond, size_t maxPoints, LivePlotSink* sink,
+                         size_t ringCapacity)
+    : ring(ringCapacity), decimation(decimation > 0 ? decimation : 1), counter(0), dropped(0),
+      framesPerSecond(framesPerSecond > 0 ? framesPerSecond : 10), maxPoints(maxPoints), sink(sink),
+      running(true), frames(0) {
+}
+
+LivePlotter::~LivePlotter() {
+    stop();
+}
+
+void LivePlotter::start() {
+    if (!plotter.joinable()) {
+        running.store(true, std::memory_order_release);
+        plotter = std::thread(&LivePlotter::run, this);
+    }
+}
+
+void LivePlotter::observe(double t, double x, double y) {
+    if (counter++ % decimation != 0) {
+        return;
+    }
+    Sample sample = { t, x, y };
+    if (!ring.push(sample)) {
+        ++dropped;
+    }
+}
+
+void LivePlotter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running.store(false, std::memory_order_release);
+    }
+    wake.notify_one();
+    if (plotter.joinable()) {
+        plotter.join();
+    }
+}
+
+void LivePlotter::run() {
+    std::unique_ptr<LivePlotSink> own;
+    LivePlotSink* target = sink;
+    if (!target) {
+        own.reset(new GnuplotSink());
+        target = own.get();
+    }
+
+    std::vector<double> tx, x, ty, y, pt, px, qt, qy;
+    std::chrono::steady_clock::duration frame = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / framesPerSecond));
+    bool more = true;
+    while (more) {
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now() + frame;
+        // read the flag before draining so the last samples make it into the final frame
+        more = running.load(std::memory_order_acquire);
+
+        size_t before = tx.size();
+        Sample sample;
+        while (ring.pop(sample)) {
+            tx.push_back(sample.t);
+            x.push_back(sample.x);
+            ty.push_back(sample.t);
+            y.push_back(sample.y);
+        }
+        compact(tx, x, maxPoints);
+        compact(ty, y, maxPoints);
+
+        if (tx.size() != before && tx.size() >= 2) {
+            downsample(tx, x, maxPoints, LargestTriangle, pt, px);
+            downsample(ty, y, maxPoints, LargestTriangle, qt, qy);
+            target->draw(pt, px, qt, qy);
+            ++frames;
+        }
+
+        if (more) {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (running.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < next) {
+                wake.wait_until(lock, next);
+            }
+        }
+    }
+}
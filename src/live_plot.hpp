@@ -0,0 +1,64 @@
+#ifndef LIVE_PLOT_HPP
+#define LIVE_PLOT_HPP
+
+#include "header.hpp"
+#include "spsc_ring.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Receives the frames of a LivePlotter on its plotting thread: the curves of
+// x and y against time, each downsampled to about maxPoints.
+class LivePlotSink {
+public:
+    virtual ~LivePlotSink() {}
+    virtual void draw(const std::vector<double>& tx, const std::vector<double>& x, const std::vector<double>& ty,
+                      const std::vector<double>& y) = 0;
+};
+
+// Plots the populations while runSimulation is still going. The integration
+// loop only pushes every decimation-th sample into a lock-free ring (dropping
+// it if the ring is full); a background thread, started by start(), drains the
+// ring and redraws at a fixed frame rate, through sink or, if it is null, its
+// own gnuplot process. The ring is cache-line aligned, so keep the plotter on
+// the stack or in aligned storage: plain new does not honour that in C++11.
+class LivePlotter : public SimulationObserver {
+public:
+    explicit LivePlotter(size_t decimation = 100, double framesPerSecond = 10, size_t maxPoints = 2000,
+                         LivePlotSink* sink = 0, size_t ringCapacity = 1 << 16);
+    ~LivePlotter();
+
+    // starts the plotting thread; samples observed before are kept in the ring
+    void start();
+
+    void observe(double t, double x, double y);
+
+    // draws the last frame, with every sample still in the ring, and joins
+    // the plotting thread; does nothing if it was never started
+    void stop();
+
+    size_t getDroppedSamples() const { return dropped; }
+    size_t getFrames() const { return frames; }
+
+private:
+    struct Sample {
+        double t, x, y;
+    };
+
+    void run();
+
+    SpscRing<Sample> ring;
+    size_t decimation, counter, dropped;
+    double framesPerSecond;
+    size_t maxPoints;
+    LivePlotSink* sink;
+    std::atomic<bool> running;
+    std::atomic<size_t> frames;
+    std::mutex mutex;
+    std::condition_variable wake;  // cuts the wait for the next frame short on stop
+    std::thread plotter;
+};
+
+#endif // LIVE_PLOT_HPP
@@ -0,0 +1,166 @@
+#include "lossy.hpp"
+#include "bitstream.hpp"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Grid indices are kept within 2^60 so that the prediction 2p - pp and the
+// residual against it stay inside int64_t, and its zigzag inside uint64_t.
+const double maxIndex = 1152921504606846976.0;  // 2^60
+
+bool validTolerance(double tolerance) {
+    return tolerance > 0 && std::isfinite(tolerance);
+}
+
+int64_t predict(int64_t previous, int64_t beforePrevious, uint64_t index) {
+    if (index == 0) {
+        return 0;
+    }
+    if (index == 1) {
+        return previous;
+    }
+    return 2 * previous - beforePrevious;
+}
+
+}
+
+// the grid is a little finer than 2 * tolerance so that rounding of k * step
+// cannot push the error up to the tolerance itself
+LossySeries::LossySeries(double tolerance)
+    : tolerance(tolerance), step(2 * tolerance * (1 - 1.0 / (1 << 20))), bits(0), count(0), previous(0),
+      beforePrevious(0), run(0) {
+    if (!validTolerance(tolerance)) {
+        throw std::invalid_argument("LossySeries: tolerance must be positive and finite");
+    }
+}
+
+void LossySeries::append(double value) {
+    double index = value / step;
+    if (!(std::fabs(index) < maxIndex)) {
+        throw std::out_of_range("LossySeries::append: value is not finite or too large for the tolerance");
+    }
+    int64_t k = static_cast<int64_t>(std::llround(index));
+    int64_t residual = k - predict(previous, beforePrevious, count);
+    if (residual == 0) {
+        ++run;
+    }
+    else {
+        putGamma(words, bits, run + 1);
+        putGamma(words, bits, zigzag(residual));
+        run = 0;
+    }
+    beforePrevious = previous;
+    previous = k;
+    ++count;
+}
+
+void LossySeries::decode(std::vector<double>& out) const {
+    out.resize(count);
+    BitReader reader(words.data(), 0);
+    int64_t p = 0, pp = 0;
+    size_t i = 0;
+    while (i < count) {
+        // the zero run still being counted by the encoder is not in words
+        uint64_t zeros = reader.position() < bits ? reader.gamma() - 1 : count - i;
+        for (uint64_t z = 0; z < zeros && i < count; ++z, ++i) {
+            int64_t k = predict(p, pp, i);
+            out[i] = k * step;
+            pp = p;
+            p = k;
+        }
+        if (i < count) {
+            int64_t k = predict(p, pp, i) + unzigzag(reader.gamma());
+            out[i++] = k * step;
+            pp = p;
+            p = k;
+        }
+    }
+}
+
+void LossySeries::write(std::ostream& out) const {
+    std::vector<uint64_t> closed(words);
+    uint64_t closedBits = bits;
+    if (run > 0) {
+        putGamma(closed, closedBits, run + 1);
+    }
+    uint64_t n = count, nwords = closed.size();
+    writeValue(out, tolerance);
+    writeValue(out, n);
+    writeValue(out, closedBits);
+    writeValue(out, nwords);
+    out.write(reinterpret_cast<const char*>(closed.data()), nwords * sizeof(uint64_t));
+}
+
+bool LossySeries::read(std::istream& in) {
+    double tol;
+    uint64_t n, nbits, nwords;
+    if (!readValue(in, tol) || !readValue(in, n) || !readValue(in, nbits) || !readValue(in, nwords) ||
+        !validTolerance(tol) || nwords != (nbits + 63) / 64) {
+        return false;
+    }
+    std::vector<uint64_t> data(nwords);
+    if (!in.read(reinterpret_cast<char*>(data.data()), nwords * sizeof(uint64_t))) {
+        return false;
+    }
+    *this = LossySeries(tol);
+    words.swap(data);
+    bits = nbits;
+    count = n;
+    return true;
+}
+
+LossyTrajectory::LossyTrajectory(double tolerance, double t0, double deltat)
+    : t0(t0), deltat(deltat), x(tolerance), y(tolerance), H(tolerance) {}
+
+void LossyTrajectory::append(double xv, double yv, double Hv) {
+    x.append(xv);
+    y.append(yv);
+    H.append(Hv);
+}
+
+void LossyTrajectory::saveResults(const std::string& filename) const {
+    std::vector<double> xs, ys, Hs;
+    x.decode(xs);
+    y.decode(ys);
+    H.decode(Hs);
+    std::ofstream file(filename.c_str());
+    file << "time,x,y,H\n";
+    for (size_t i = 0; i < xs.size(); ++i) {
+        file << t0 + i * deltat << "," << xs[i] << "," << ys[i] << "," << Hs[i] << "\n";
+    }
+}
+
+bool LossyTrajectory::save(const std::string& filename) const {
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    file.write("LVQ1", 4);
+    writeValue(file, t0);
+    writeValue(file, deltat);
+    x.write(file);
+    y.write(file);
+    H.write(file);
+    return static_cast<bool>(file);
+}
+
+bool LossyTrajectory::load(const std::string& filename) {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    char magic[4];
+    if (!file.read(magic, 4) || std::memcmp(magic, "LVQ1", 4) != 0) {
+        return false;
+    }
+    return readValue(file, t0) && readValue(file, deltat) && x.read(file) && y.read(file) && H.read(file) &&
+           x.size() == y.size() && x.size() == H.size();
+}
+
+LossyTrajectoryEncoder::LossyTrajectoryEncoder(const Simulation& sim, double tolerance)
+    : sim(sim), trajectory(tolerance, 0, sim.getDeltat()), started(false) {}
+
+void LossyTrajectoryEncoder::observe(double t, double x, double y) {
+    if (!started) {
+        trajectory = LossyTrajectory(trajectory.getTolerance(), t, sim.getDeltat());
+        started = true;
+    }
+    trajectory.append(x, y, sim.calculateH(x, y));
+}
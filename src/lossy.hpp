@@ -0,0 +1,89 @@
+#ifndef LOSSY_HPP
+#define LOSSY_HPP
+
+#include "header.hpp"
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Error-bounded lossy series: every value is rounded to a grid of spacing
+// just under 2 * tolerance, so |v - decoded| < tolerance as long as the
+// tolerance is above about 1e-10 |v|. Grid indices are predicted by linear
+// extrapolation of the two before them, exactly, in integers; the residuals
+// are mostly zero and are stored as Elias gamma coded zero runs, each followed
+// by the nonzero residual that ends it. Values are appended one at a time, so
+// the series can be filled while a run is going.
+class LossySeries {
+public:
+    // throws std::invalid_argument unless tolerance is positive and finite
+    explicit LossySeries(double tolerance = 1e-6);
+
+    // throws std::out_of_range for NaN, infinities and |value| >= 2^61 * tolerance
+    void append(double value);
+
+    size_t size() const { return count; }
+    double getTolerance() const { return tolerance; }
+    void decode(std::vector<double>& out) const;
+
+    size_t compressedBytes() const { return words.size() * sizeof(uint64_t); }
+
+    // a series read back is complete: append only to series being encoded
+    void write(std::ostream& out) const;
+    bool read(std::istream& in);
+
+private:
+    double tolerance, step;
+    std::vector<uint64_t> words;
+    uint64_t bits;
+    size_t count;
+    int64_t previous, beforePrevious;  // grid indices
+    uint64_t run;                      // zero residuals not written yet
+};
+
+// time, x, y and H of a run as LossySeries with one tolerance, time being
+// implicit. Saved files start with "LVQ1".
+class LossyTrajectory {
+public:
+    explicit LossyTrajectory(double tolerance = 1e-6, double t0 = 0, double deltat = 0.001);
+
+    void append(double x, double y, double H);
+
+    size_t size() const { return x.size(); }
+    double getTolerance() const { return x.getTolerance(); }
+    double getDeltat() const { return deltat; }
+    size_t compressedBytes() const { return x.compressedBytes() + y.compressedBytes() + H.compressedBytes(); }
+
+    const LossySeries& getXSeries() const { return x; }
+    const LossySeries& getYSeries() const { return y; }
+    const LossySeries& getHSeries() const { return H; }
+
+    // same layout as Simulation::saveResults
+    void saveResults(const std::string& filename) const;
+
+    bool save(const std::string& filename) const;
+    bool load(const std::string& filename);
+
+private:
+    double t0, deltat;
+    LossySeries x, y, H;
+};
+
+// Streaming encoder: register it with addObserver and it codes every sample of
+// runSimulation, with H from the simulation's model, as it is produced.
+class LossyTrajectoryEncoder : public SimulationObserver {
+public:
+    LossyTrajectoryEncoder(const Simulation& sim, double tolerance);
+
+    void observe(double t, double x, double y);
+
+    const LossyTrajectory& getTrajectory() const { return trajectory; }
+
+private:
+    const Simulation& sim;
+    LossyTrajectory trajectory;
+    bool started;
+};
+
+#endif // LOSSY_HPP
@@ -0,0 +1,39 @@
+#ifndef LOTKA_VOLTERRA_HPP
+#define LOTKA_VOLTERRA_HPP
+
+#include "scalar.hpp"
+
+// Euler-stepped Lotka-Volterra state, generic over the scalar type so the
+// same update runs on float, double, long double, __float128 and Dual
+// numbers. Populations are stored relative to the equilibrium (D/C, A/B).
+template <typename T>
+class LotkaVolterra {
+public:
+    LotkaVolterra(T x0, T y0, T A, T B, T C, T D, T deltat)
+        : A(A), B(B), C(C), D(D), deltat(deltat) {
+        e2_x = D / C;
+        e2_y = A / B;
+        x_rel = x0 / e2_x;
+        y_rel = y0 / e2_y;
+    }
+
+    void evolve() {
+        T new_x_rel = x_rel + (A - B * y_rel * e2_y) * x_rel * deltat;
+        T new_y_rel = y_rel + (C * x_rel * e2_x - D) * y_rel * deltat;
+        x_rel = new_x_rel > 0 ? new_x_rel : T(1e-6);
+        y_rel = new_y_rel > 0 ? new_y_rel : T(1e-6);
+    }
+
+    T getX() const { return x_rel * e2_x; }
+    T getY() const { return y_rel * e2_y; }
+
+    T calculateH(const T& x, const T& y) const {
+        return -D * scalarLog(x) + C * x + B * y - A * scalarLog(y);
+    }
+
+private:
+    T x_rel, y_rel, A, B, C, D, deltat;
+    T e2_x, e2_y;
+};
+
+#endif // LOTKA_VOLTERRA_HPP
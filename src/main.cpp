@@ -1,8 +1,28 @@
 #include "header.hpp"
+#include "batch.hpp"
+#include "live_plot.hpp"
+#include <fstream>
 #include <iostream>
 #include <string>
 
-int main() {
+int main(int argc, char* argv[]) {
+    // sim --batch [file|-]: non-interactive jobs from a file or stdin
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        std::ios::sync_with_stdio(false);
+        if (argc > 2 && std::string(argv[2]) != "-") {
+            std::ifstream jobs(argv[2]);
+            if (!jobs) {
+                std::cerr << "Errore: impossibile aprire " << argv[2] << std::endl;
+                return 1;
+            }
+            return runBatch(jobs, std::cout) == 0 ? 0 : 1;
+        }
+        return runBatch(std::cin, std::cout) == 0 ? 0 : 1;
+    }
+
+    // sim --live: also plots the populations while the run is going
+    bool live = argc > 1 && std::string(argv[1]) == "--live";
+
     double x0 = 1200.0;
     double y0 = 1000.0;
     double A = 2.0;
@@ -47,7 +67,19 @@ int main() {
     std::cin >> totalTime;
 
     Simulation sim(x0, y0, A, B, C, D, deltat);
+    // lives as long as sim, which keeps a pointer to it once added
+    LivePlotter plotter;
+    if (live) {
+        plotter.start();
+        sim.addObserver(&plotter);
+    }
     sim.runSimulation(totalTime);
+    if (live) {
+        plotter.stop();
+        if (plotter.getDroppedSamples() > 0) {
+            std::cout << "Grafico in tempo reale: " << plotter.getDroppedSamples() << " campioni scartati." << std::endl;
+        }
+    }
     sim.saveResults("results.csv");
     sim.plotResultsWithGnuplot();
     sim.plotHWithGnuplot();
@@ -0,0 +1,59 @@
+#include "measure.hpp"
+#include <chrono>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+bool measureInChild(void (*workload)(), int repetitions, std::vector<double>& seconds, long& peakRssKb,
+                    long& forkRssKb) {
+    seconds.clear();
+    peakRssKb = -1;
+    forkRssKb = -1;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (child == 0) {
+        close(fds[0]);
+        // the high-water mark of a new child is the RSS it inherited
+        rusage start;
+        getrusage(RUSAGE_SELF, &start);
+        double inherited = static_cast<double>(start.ru_maxrss);
+        if (write(fds[1], &inherited, sizeof(inherited)) != sizeof(inherited)) {
+            _exit(1);
+        }
+        for (int r = 0; r < repetitions; ++r) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            workload();
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (write(fds[1], &elapsed, sizeof(elapsed)) != sizeof(elapsed)) {
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    double elapsed;
+    if (read(fds[0], &elapsed, sizeof(elapsed)) == sizeof(elapsed)) {
+        forkRssKb = static_cast<long>(elapsed);
+    }
+    while (read(fds[0], &elapsed, sizeof(elapsed)) == sizeof(elapsed)) {
+        seconds.push_back(elapsed);
+    }
+    close(fds[0]);
+    int status = 0;
+    rusage usage;
+    if (wait4(child, &status, 0, &usage) != child) {
+        return false;
+    }
+    peakRssKb = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 && seconds.size() == static_cast<size_t>(repetitions);
+}
@@ -0,0 +1,16 @@
+#ifndef MEASURE_HPP
+#define MEASURE_HPP
+
+#include <vector>
+
+// Runs workload repetitions times in a forked child and reads its peak RSS
+// with wait4. A forked child starts with the parent's resident pages counted
+// in its RSS, so peakRssKb includes whatever the parent had resident at the
+// fork; forkRssKb is that starting point, and peakRssKb - forkRssKb is what
+// the workload added. The child sends the wall time of each repetition through
+// a pipe. Returns false if the child cannot be started or does not report
+// every repetition and exit cleanly.
+bool measureInChild(void (*workload)(), int repetitions, std::vector<double>& seconds, long& peakRssKb,
+                    long& forkRssKb);
+
+#endif // MEASURE_HPP
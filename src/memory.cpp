@@ -0,0 +1,148 @@
+#include "memory.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+class NewDeleteResource : public MemoryResource {
+public:
+    void* allocate(size_t bytes, size_t) {
+        return ::operator new(bytes);
+    }
+    void deallocate(void* p, size_t, size_t) {
+        ::operator delete(p);
+    }
+};
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+const size_t hugePage = 2 * 1024 * 1024;
+
+}
+
+MemoryResource* defaultResource() {
+    static NewDeleteResource resource;
+    return &resource;
+}
+
+MonotonicArena::MonotonicArena(size_t chunkSize, MemoryResource* upstream)
+    : current(0), offset(0), last(0), chunkSize(chunkSize), used(0), reserved(0), upstream(upstream) {
+}
+
+MonotonicArena::~MonotonicArena() {
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        upstream->deallocate(chunks[i].data, chunks[i].size, alignof(std::max_align_t));
+    }
+}
+
+void* MonotonicArena::allocate(size_t bytes, size_t alignment) {
+    while (current < chunks.size()) {
+        size_t start = alignUp(offset, alignment);
+        if (start + bytes <= chunks[current].size) {
+            offset = start + bytes;
+            used += bytes;
+            last = chunks[current].data + start;
+            return last;
+        }
+        // the rest of this chunk is skipped until the next reset
+        ++current;
+        offset = 0;
+    }
+
+    // grow geometrically so long runs need few chunks
+    size_t size = chunkSize;
+    if (!chunks.empty() && chunks.back().size * 2 > size) {
+        size = chunks.back().size * 2;
+    }
+    if (size < bytes + alignment) {
+        size = bytes + alignment;
+    }
+    Chunk chunk = { static_cast<char*>(upstream->allocate(size, alignof(std::max_align_t))), size };
+    chunks.push_back(chunk);
+    reserved += size;
+    current = chunks.size() - 1;
+    offset = 0;
+    return allocate(bytes, alignment);
+}
+
+void MonotonicArena::deallocate(void* p, size_t bytes, size_t) {
+    if (p == last && current < chunks.size()) {
+        offset = static_cast<char*>(p) - chunks[current].data;
+        used -= bytes;
+        last = 0;
+    }
+}
+
+void MonotonicArena::reset() {
+    current = 0;
+    offset = 0;
+    last = 0;
+    used = 0;
+}
+
+MonotonicArena& threadArena() {
+    thread_local MonotonicArena arena;
+    return arena;
+}
+
+HugePageResource::HugePageResource(bool explicitHugeTlb)
+    : explicitHugeTlb(explicitHugeTlb), hugeTlb(0), transparent(0), fallback(0), small(0) {
+}
+
+void* HugePageResource::allocate(size_t bytes, size_t alignment) {
+    if (bytes < hugePage) {
+        ++small;
+        return defaultResource()->allocate(bytes, alignment);
+    }
+#ifdef __linux__
+    (void)alignment;
+    size_t size = alignUp(bytes, hugePage);
+    if (explicitHugeTlb) {
+        void* p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            ++hugeTlb;
+            return p;
+        }
+    }
+
+    // over-map by one page and trim so the block starts on a 2 MB boundary
+    char* raw = static_cast<char*>(mmap(0, size + hugePage, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (raw == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    char* aligned = reinterpret_cast<char*>(alignUp(reinterpret_cast<size_t>(raw), hugePage));
+    if (aligned > raw) {
+        munmap(raw, aligned - raw);
+    }
+    munmap(aligned + size, raw + hugePage - aligned);
+#ifdef MADV_HUGEPAGE
+    if (madvise(aligned, size, MADV_HUGEPAGE) == 0) {
+        ++transparent;
+        return aligned;
+    }
+#endif
+    ++fallback;
+    return aligned;
+#else
+    ++fallback;
+    return defaultResource()->allocate(bytes, alignment);
+#endif
+}
+
+void HugePageResource::deallocate(void* p, size_t bytes, size_t alignment) {
+    if (bytes < hugePage) {
+        defaultResource()->deallocate(p, bytes, alignment);
+        return;
+    }
+#ifdef __linux__
+    (void)alignment;
+    munmap(p, alignUp(bytes, hugePage));
+#else
+    defaultResource()->deallocate(p, bytes, alignment);
+#endif
+}
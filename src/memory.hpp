@@ -0,0 +1,142 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Source of raw memory for trajectory storage, in the spirit of
+// std::pmr::memory_resource (not available in C++11).
+class MemoryResource {
+public:
+    virtual ~MemoryResource() {}
+    virtual void* allocate(size_t bytes, size_t alignment) = 0;
+    virtual void deallocate(void* p, size_t bytes, size_t alignment) = 0;
+};
+
+// operator new / operator delete
+MemoryResource* defaultResource();
+
+// Bump allocator over chunks taken from upstream. deallocate only gives back
+// the most recent allocation; everything else is reclaimed at once by reset(),
+// which keeps the chunks for the next batch. Not thread safe: use one arena
+// per thread, e.g. threadArena().
+//
+// What it saves is allocator and page-fault time (the bench sweep of 1000
+// simulations takes about 25% less). It does not lower peak RSS, and was not
+// made to: that is set by the trajectories alive at once, which runSimulation
+// reserves exactly on the heap as well, and the arena adds up to one partly
+// used chunk (see arena_added_rss_kb in the bench sweep row).
+class MonotonicArena : public MemoryResource {
+public:
+    explicit MonotonicArena(size_t chunkSize = 1 << 20, MemoryResource* upstream = defaultResource());
+    ~MonotonicArena();
+
+    void* allocate(size_t bytes, size_t alignment);
+    void deallocate(void* p, size_t bytes, size_t alignment);
+
+    // Every object allocated from the arena must be gone before this.
+    void reset();
+
+    size_t bytesInUse() const { return used; }
+    size_t bytesReserved() const { return reserved; }
+
+private:
+    MonotonicArena(const MonotonicArena&);
+    MonotonicArena& operator=(const MonotonicArena&);
+
+    struct Chunk {
+        char* data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t current;   // chunk being filled
+    size_t offset;    // first free byte in it
+    void* last;       // most recent allocation, for in-place rollback
+    size_t chunkSize, used, reserved;
+    MemoryResource* upstream;
+};
+
+// Arena private to the calling thread.
+MonotonicArena& threadArena();
+
+// Memory mapped in 2 MB pages to cut TLB misses when scanning very long
+// trajectories. With explicitHugeTlb it first tries MAP_HUGETLB (needs pages
+// reserved in /proc/sys/vm/nr_hugepages); otherwise, or if that fails, it maps
+// 2 MB aligned memory and asks for transparent huge pages with madvise. Off
+// Linux it falls back to operator new. Blocks under 2 MB come from operator
+// new as well, so a short run costs what it does on the heap; larger ones are
+// rounded up to whole 2 MB pages.
+class HugePageResource : public MemoryResource {
+public:
+    explicit HugePageResource(bool explicitHugeTlb = false);
+
+    void* allocate(size_t bytes, size_t alignment);
+    void deallocate(void* p, size_t bytes, size_t alignment);
+
+    size_t getHugeTlbAllocations() const { return hugeTlb; }
+    size_t getTransparentAllocations() const { return transparent; }
+    size_t getFallbackAllocations() const { return fallback; }
+    size_t getSmallAllocations() const { return small; }
+
+private:
+    bool explicitHugeTlb;
+    size_t hugeTlb, transparent, fallback, small;
+};
+
+// Standard allocator drawing from a MemoryResource.
+template <typename T>
+class ResourceAllocator {
+public:
+    typedef T value_type;
+
+    ResourceAllocator(MemoryResource* resource = 0) : resource(resource ? resource : defaultResource()) {}
+    template <typename U>
+    ResourceAllocator(const ResourceAllocator<U>& other) : resource(other.getResource()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, size_t n) {
+        resource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    MemoryResource* getResource() const { return resource; }
+
+private:
+    MemoryResource* resource;
+};
+
+template <typename T, typename U>
+bool operator==(const ResourceAllocator<T>& a, const ResourceAllocator<U>& b) {
+    return a.getResource() == b.getResource();
+}
+template <typename T, typename U>
+bool operator!=(const ResourceAllocator<T>& a, const ResourceAllocator<U>& b) {
+    return !(a == b);
+}
+
+typedef std::vector<double, ResourceAllocator<double> > Trajectory;
+
+// Read-only view of a stored series, whether a std::vector<double> or a
+// Trajectory holds it. Valid until the series next grows or is cleared.
+class TrajectoryView {
+public:
+    TrajectoryView(const double* first, size_t count) : first(first), count(count) {}
+
+    const double* data() const { return first; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const double* begin() const { return first; }
+    const double* end() const { return first + count; }
+    double operator[](size_t i) const { return first[i]; }
+    double front() const { return first[0]; }
+    double back() const { return first[count - 1]; }
+
+private:
+    const double* first;
+    size_t count;
+};
+
+#endif // MEMORY_HPP
@@ -0,0 +1,210 @@
+#ifndef MODELS_HPP
+#define MODELS_HPP
+
+#include "forcing.hpp"
+#include "scalar.hpp"
+
+// Right-hand sides for ModelSimulation. A model provides
+//   void rates(T x, T y, T& dx, T& dy) const   population derivatives
+//   T invariant(T x, T y) const                conserved or Lyapunov function
+//   void advance()                             moves time-dependent parameters
+//                                              on by one step
+//   void floors(T& x, T& y) const              populations a step is clamped
+//                                              to instead of reaching zero
+// and is passed by type, so the stepping loop is compiled for each model with
+// its rates inlined.
+
+// Classic mass-action model; invariant is the conserved H of Simulation.
+template <typename T>
+struct LotkaVolterraModel {
+    T A, B, C, D;
+
+    LotkaVolterraModel(T A, T B, T C, T D) : A(A), B(B), C(C), D(D) {}
+
+    void rates(T x, T y, T& dx, T& dy) const {
+        dx = (A - B * y) * x;
+        dy = (C * x - D) * y;
+    }
+
+    T invariant(T x, T y) const {
+        return -D * scalarLog(x) + C * x + B * y - A * scalarLog(y);
+    }
+
+    void advance() {}
+
+    // Simulation's floor: 1e-6 of the equilibrium (D / C, A / B)
+    void floors(T& x, T& y) const {
+        x = T(1e-6) * D / C;
+        y = T(1e-6) * A / B;
+    }
+};
+
+// Lotka-Volterra with seasonal prey growth A(t) and predator death D(t) read
+// from ForcingTables built with the simulation's deltat. The tables are copied
+// in, so the model stays valid when the caller's tables go away. invariant is
+// H with the parameters of the current step; it is not conserved.
+template <typename T>
+struct SeasonalLotkaVolterra {
+    ForcingTable A;
+    T B, C;
+    ForcingTable D;
+    size_t stepA, stepD;
+
+    SeasonalLotkaVolterra(const ForcingTable& A, T B, T C, const ForcingTable& D)
+        : A(A), B(B), C(C), D(D), stepA(0), stepD(0) {}
+
+    void rates(T x, T y, T& dx, T& dy) const {
+        dx = (T(A[stepA]) - B * y) * x;
+        dy = (C * x - T(D[stepD])) * y;
+    }
+
+    T invariant(T x, T y) const {
+        return -T(D[stepD]) * scalarLog(x) + C * x + B * y - T(A[stepA]) * scalarLog(y);
+    }
+
+    // Simulation's floor with the parameters of the current step
+    void floors(T& x, T& y) const {
+        x = T(1e-6) * T(D[stepD]) / C;
+        y = T(1e-6) * T(A[stepA]) / B;
+    }
+
+    void advance() {
+        if (++stepA == A.size()) {
+            stepA = 0;
+        }
+        if (++stepD == D.size()) {
+            stepD = 0;
+        }
+    }
+};
+
+// Functional responses f(x), the prey taken per predator per unit time. Each
+// also gives the integral of 1 / f used by the Lyapunov function.
+template <typename T>
+struct LinearResponse {
+    T a;
+
+    explicit LinearResponse(T a) : a(a) {}
+    T operator()(T x) const { return a * x; }
+    // integral of 1 / f from x0 to x
+    T reciprocalIntegral(T x0, T x) const { return (scalarLog(x) - scalarLog(x0)) / a; }
+};
+
+// Holling type II: a x / (1 + a h x), saturating with handling time h.
+template <typename T>
+struct HollingTypeII {
+    T a, h;
+
+    HollingTypeII(T a, T h) : a(a), h(h) {}
+    T operator()(T x) const { return a * x / (1 + a * h * x); }
+    T reciprocalIntegral(T x0, T x) const { return (scalarLog(x) - scalarLog(x0)) / a + h * (x - x0); }
+};
+
+// Holling type III: a x^2 / (1 + a h x^2), sigmoid at low prey density.
+template <typename T>
+struct HollingTypeIII {
+    T a, h;
+
+    HollingTypeIII(T a, T h) : a(a), h(h) {}
+    T operator()(T x) const { return a * x * x / (1 + a * h * x * x); }
+    T reciprocalIntegral(T x0, T x) const { return (1 / x0 - 1 / x) / a + h * (x - x0); }
+};
+
+// Logistic prey with carrying capacity K and growth rate r, predators
+// converting prey with efficiency e and dying at rate m:
+//   x' = r x (1 - x / K) - f(x) y
+//   y' = e f(x) y - m y
+// With a Holling type II response this is the Rosenzweig-MacArthur model.
+// invariant is Hsu's function
+//   V = (x - x*) - f(x*) * integral_x*^x ds / f(s) + (y - y* - y* ln(y / y*)) / e
+// around the coexistence equilibrium (x*, y*); dV/dt = (f(x) - f(x*)) (g(x) - g(x*))
+// with g(x) = r x (1 - x / K) / f(x), so V is a Lyapunov function wherever g
+// decreases as f increases, e.g. always for the linear response and for
+// type II when x* > (K - 1 / (a h)) / 2.
+template <typename T, template <typename> class Response>
+struct PredatorPreyModel {
+    T r, K, e, m;
+    Response<T> f;
+    T xStar, yStar;
+
+    PredatorPreyModel(T r, T K, const Response<T>& f, T e, T m) : r(r), K(K), e(e), m(m), f(f) {
+        // e f(x*) = m, by bisection since f is increasing
+        T lo = 0, hi = K;
+        for (int i = 0; i < 200; ++i) {
+            T mid = (lo + hi) / 2;
+            if (e * f(mid) < m) {
+                lo = mid;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        xStar = (lo + hi) / 2;
+        yStar = r * xStar * (1 - xStar / K) / f(xStar);
+    }
+
+    void rates(T x, T y, T& dx, T& dy) const {
+        T eaten = f(x);
+        dx = r * x * (1 - x / K) - eaten * y;
+        dy = (e * eaten - m) * y;
+    }
+
+    T invariant(T x, T y) const {
+        return (x - xStar) - f(xStar) * f.reciprocalIntegral(xStar, x) +
+               (y - yStar - yStar * (scalarLog(y) - scalarLog(yStar))) / e;
+    }
+
+    void advance() {}
+
+    // 1e-6 of the coexistence equilibrium, as Simulation does for its model,
+    // or 1e-6 itself where there is none
+    void floors(T& x, T& y) const {
+        x = xStar > 0 ? T(1e-6) * xStar : T(1e-6);
+        y = yStar > 0 ? T(1e-6) * yStar : T(1e-6);
+    }
+};
+
+template <typename T>
+struct RosenzweigMacArthur : PredatorPreyModel<T, HollingTypeII> {
+    RosenzweigMacArthur(T r, T K, T a, T h, T e, T m)
+        : PredatorPreyModel<T, HollingTypeII>(r, K, HollingTypeII<T>(a, h), e, m) {}
+};
+
+// Euler stepping of any model above. Populations that would drop to zero or
+// below are clamped to the model's floors, which for LotkaVolterraModel are
+// Simulation's, so the two agree step for step even once a population hits
+// the floor.
+template <typename Model, typename T = double>
+class ModelSimulation {
+public:
+    ModelSimulation(const Model& model, T x0, T y0, T deltat) : model(model), x(x0), y(y0), deltat(deltat) {}
+
+    void evolve() {
+        T dx, dy;
+        model.rates(x, y, dx, dy);
+        T newX = x + dx * deltat;
+        T newY = y + dy * deltat;
+        T floorX, floorY;
+        model.floors(floorX, floorY);
+        x = newX > 0 ? newX : floorX;
+        y = newY > 0 ? newY : floorY;
+        model.advance();
+    }
+
+    void run(long steps) {
+        for (long i = 0; i < steps; ++i) {
+            evolve();
+        }
+    }
+
+    T getX() const { return x; }
+    T getY() const { return y; }
+    T getInvariant() const { return model.invariant(x, y); }
+    const Model& getModel() const { return model; }
+
+private:
+    Model model;
+    T x, y, deltat;
+};
+
+#endif // MODELS_HPP
@@ -0,0 +1,218 @@
+#include "perf_counters.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* phaseNames[PhaseCount] = { "evolve", "calculateH", "append", "saveResults", "plotting" };
+
+#ifdef __linux__
+int openCounter(unsigned type, unsigned long long config, int group) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+}
+#endif
+
+// The counter group of one thread, opened on its first scope and closed when
+// the thread exits.
+struct ThreadGroup {
+    int fds[PerfCounters::CounterCount];
+    int slot[PerfCounters::CounterCount];  // position of each counter in the group read, -1 if unavailable
+    int opened;
+    bool tried;
+    bool started[PhaseCount];
+    unsigned long long start[PhaseCount][PerfCounters::CounterCount];
+
+    ThreadGroup() : opened(0), tried(false) {
+        for (int c = 0; c < PerfCounters::CounterCount; ++c) {
+            fds[c] = -1;
+            slot[c] = -1;
+        }
+        std::memset(started, 0, sizeof(started));
+    }
+
+    ~ThreadGroup() {
+#ifdef __linux__
+        for (int c = 0; c < PerfCounters::CounterCount; ++c) {
+            if (fds[c] >= 0) {
+                close(fds[c]);
+            }
+        }
+#endif
+    }
+
+    // true if at least one counter could be opened
+    bool open() {
+        if (tried) {
+            return opened > 0;
+        }
+        tried = true;
+#ifdef __linux__
+        const unsigned types[PerfCounters::CounterCount] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+        };
+        const unsigned long long configs[PerfCounters::CounterCount] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+        };
+        int leader = -1;
+        for (int c = 0; c < PerfCounters::CounterCount; ++c) {
+            fds[c] = openCounter(types[c], configs[c], leader);
+            if (fds[c] >= 0) {
+                if (leader == -1) {
+                    leader = fds[c];
+                }
+                slot[c] = opened++;
+            }
+        }
+        if (leader == -1) {
+            return false;
+        }
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool read(unsigned long long values[PerfCounters::CounterCount]) const {
+#ifdef __linux__
+        if (opened == 0) {
+            return false;
+        }
+        int leader = -1;
+        for (int c = 0; c < PerfCounters::CounterCount && leader == -1; ++c) {
+            leader = fds[c];
+        }
+        unsigned long long buffer[1 + PerfCounters::CounterCount];
+        if (::read(leader, buffer, sizeof(buffer)) < static_cast<ssize_t>(sizeof(unsigned long long) * (1 + opened))) {
+            return false;
+        }
+        for (int c = 0; c < PerfCounters::CounterCount; ++c) {
+            values[c] = slot[c] >= 0 ? buffer[1 + slot[c]] : 0;
+        }
+        return true;
+#else
+        (void)values;
+        return false;
+#endif
+    }
+};
+
+thread_local ThreadGroup group;
+
+}
+
+PerfCounters& PerfCounters::instance() {
+    static PerfCounters counters;
+    return counters;
+}
+
+PerfCounters::PerfCounters() : active(false) {
+    for (int c = 0; c < CounterCount; ++c) {
+        available[c] = false;
+    }
+    std::memset(totals, 0, sizeof(totals));
+    std::memset(calls, 0, sizeof(calls));
+    const char* env = std::getenv("SIM_PERF_COUNTERS");
+    if (env && std::strcmp(env, "1") == 0) {
+        enable();
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    report(std::cerr);
+}
+
+bool PerfCounters::enable() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (active.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (!group.open()) {
+        std::cerr << "Contatori hardware non disponibili (perf_event_open)." << std::endl;
+        return false;
+    }
+    for (int c = 0; c < CounterCount; ++c) {
+        available[c] = group.slot[c] >= 0;
+    }
+    active.store(true, std::memory_order_release);
+    return true;
+}
+
+void PerfCounters::begin(Phase phase) {
+    group.started[phase] = group.open() && group.read(group.start[phase]);
+}
+
+void PerfCounters::end(Phase phase) {
+    unsigned long long now[CounterCount];
+    if (!group.started[phase] || !group.read(now)) {
+        return;
+    }
+    group.started[phase] = false;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int c = 0; c < CounterCount; ++c) {
+        totals[phase][c] += now[c] - group.start[phase][c];
+    }
+    ++calls[phase];
+}
+
+bool PerfCounters::sample(Counter counter, unsigned long long& value) {
+    unsigned long long values[CounterCount];
+    if (!group.open() || group.slot[counter] < 0 || !group.read(values)) {
+        return false;
+    }
+    value = values[counter];
+    return true;
+}
+
+void PerfCounters::report(std::ostream& os) const {
+    if (!enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    os << "\n" << std::left << std::setw(12) << "fase" << std::right
+       << std::setw(10) << "chiamate" << std::setw(16) << "cicli" << std::setw(16) << "istruzioni"
+       << std::setw(7) << "IPC" << std::setw(14) << "cache miss" << std::setw(14) << "branch miss"
+       << std::setw(14) << "dTLB miss" << "\n";
+    for (int p = 0; p < PhaseCount; ++p) {
+        if (calls[p] == 0) {
+            continue;
+        }
+        const unsigned long long* v = totals[p];
+        os << std::left << std::setw(12) << phaseNames[p] << std::right << std::setw(10) << calls[p];
+        for (int c = 0; c < CounterCount; ++c) {
+            if (!available[c]) {
+                os << std::setw(c == Cycles || c == Instructions ? 16 : 14) << "-";
+            }
+            else {
+                os << std::setw(c == Cycles || c == Instructions ? 16 : 14) << v[c];
+            }
+            if (c == Instructions) {
+                double ipc = v[Cycles] > 0 ? static_cast<double>(v[Instructions]) / v[Cycles] : 0;
+                os << std::setw(7) << std::fixed << std::setprecision(2) << ipc;
+                os.unsetf(std::ios::fixed);
+            }
+        }
+        os << "\n";
+    }
+}
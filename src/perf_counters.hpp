@@ -0,0 +1,69 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <atomic>
+#include <mutex>
+#include <ostream>
+
+enum Phase {
+    PhaseEvolve,
+    PhaseCalculateH,
+    PhaseAppend,
+    PhaseSaveResults,
+    PhasePlotting,
+    PhaseCount
+};
+
+// Hardware counters (cycles, instructions, cache, branch and dTLB misses) read
+// through perf_event_open around the phases of a run. Off unless enable() is
+// called or SIM_PERF_COUNTERS=1 is set; when on, a summary table is printed
+// to stderr at program exit. Where the counters cannot be opened (no Linux,
+// perf_event_paranoid too strict) it stays off and costs one branch per scope.
+// Each thread that enters a scope opens its own counter group on first use,
+// since a group opened with pid 0 counts only the thread that opened it; the
+// per-thread deltas are summed into one table under a lock.
+class PerfCounters {
+public:
+    enum Counter { Cycles, Instructions, CacheMisses, BranchMisses, TlbMisses, CounterCount };
+
+    static PerfCounters& instance();
+
+    bool enable();
+    bool enabled() const { return active.load(std::memory_order_acquire); }
+
+    void begin(Phase phase);
+    void end(Phase phase);
+
+    // Running count of one counter on the calling thread, whether or not
+    // enable() was called; false if it cannot be opened here. The difference
+    // of two samples measures the code between them.
+    bool sample(Counter counter, unsigned long long& value);
+
+    void report(std::ostream& os) const;
+
+private:
+    PerfCounters();
+    ~PerfCounters();
+
+    std::atomic<bool> active;
+    bool available[CounterCount];  // opened on the thread that called enable
+    mutable std::mutex mutex;      // guards totals and calls
+    unsigned long long totals[PhaseCount][CounterCount];
+    unsigned long long calls[PhaseCount];
+};
+
+class PerfScope {
+public:
+    explicit PerfScope(Phase phase) : phase(phase), on(PerfCounters::instance().enabled()) {
+        if (on) PerfCounters::instance().begin(phase);
+    }
+    ~PerfScope() {
+        if (on) PerfCounters::instance().end(phase);
+    }
+
+private:
+    Phase phase;
+    bool on;
+};
+
+#endif // PERF_COUNTERS_HPP
@@ -0,0 +1,104 @@
+#include "philox.hpp"
+#include "bitstream.hpp"
+
+namespace {
+
+const size_t batch = 256;
+
+// 23 random bits as a float in [1, 2)
+inline float unitMantissa(uint32_t bits) {
+    return floatFromBits((bits & 0x007FFFFFu) | 0x3F800000u);
+}
+
+// log u for normal u > 0: u = m 2^e with m in [sqrt(1/2), sqrt(2)), and
+// log m = 2 atanh(s), s = (m - 1) / (m + 1), |s| < 0.172, summed to s^9
+inline float logPositive(float u) {
+    uint32_t bits = floatToBits(u);
+    uint32_t high = (bits & 0x007FFFFFu) > 0x003504F3u ? 1u : 0u;
+    float m = floatFromBits((bits & 0x007FFFFFu) | (0x3F800000u - (high << 23)));
+    float exponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127 + static_cast<int32_t>(high));
+    float s = (m - 1) / (m + 1);
+    float s2 = s * s;
+    float p = 1.0f / 9;
+    p = 1.0f / 7 + s2 * p;
+    p = 1.0f / 5 + s2 * p;
+    p = 1.0f / 3 + s2 * p;
+    p = 1.0f + s2 * p;
+    return exponent * 0.693147181f + 2 * s * p;
+}
+
+// sqrt t for t >= 0 without the errno path of sqrt, which keeps the loop from
+// vectorising: a bit-level estimate of 1 / sqrt t refined by three Newton steps
+inline float sqrtNonNegative(float t) {
+    float y = floatFromBits(0x5F3759DFu - (floatToBits(t) >> 1));
+    for (int k = 0; k < 3; ++k) {
+        y = y * (1.5f - 0.5f * t * y * y);
+    }
+    return t * y;
+}
+
+// Taylor series on |a| <= pi/4, to a^9 and a^10
+inline float sinSmall(float a) {
+    float a2 = a * a;
+    float p = 1.0f / 362880;
+    p = -1.0f / 5040 + a2 * p;
+    p = 1.0f / 120 + a2 * p;
+    p = -1.0f / 6 + a2 * p;
+    return a + a * a2 * p;
+}
+
+inline float cosSmall(float a) {
+    float a2 = a * a;
+    float p = -1.0f / 3628800;
+    p = 1.0f / 40320 + a2 * p;
+    p = -1.0f / 720 + a2 * p;
+    p = 1.0f / 24 + a2 * p;
+    p = -0.5f + a2 * p;
+    return 1 + a2 * p;
+}
+
+// One Box-Muller pair from two Philox words: the radius from u in (0, 1] with
+// 31-bit resolution (so |z| < 6.7), the angle from a quadrant and a 23-bit
+// offset in [-pi/4, pi/4). Variates agree with the double formula to 1e-6,
+// except that u near 1 rounds to 24 bits, so radii below 1e-3 fall on a
+// 2e-4 grid. The variates only scale increments of size sqrt(dt), so single
+// precision is far below the sampling error, and it fills twice the lanes of
+// a double.
+inline void boxMuller(uint32_t radiusBits, uint32_t angleBits, double& z0, double& z1) {
+    float u = (static_cast<float>(static_cast<int32_t>(radiusBits >> 1)) + 0.5f) * 4.65661287e-10f;
+    float r = sqrtNonNegative(-2 * logPositive(u));
+    uint32_t q = angleBits >> 30;
+    float a = (unitMantissa((angleBits & 0x3FFFFFFFu) >> 7) - 1.5f) * 1.57079633f;
+    float c = cosSmall(a), s = sinSmall(a);
+    // rotate (cos a, sin a) by q quarter turns
+    float cq = (q & 1) ? s : c, sq = (q & 1) ? c : s;
+    z0 = ((q + 1) & 2 ? -r : r) * cq;
+    z1 = (q & 2 ? -r : r) * sq;
+}
+
+}
+
+void philoxNormals(uint64_t seed, uint64_t stream, uint64_t first, size_t n, double* z0, double* z1, double* z2,
+                   double* z3) {
+    const uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+    const uint32_t s0 = static_cast<uint32_t>(stream), s1 = static_cast<uint32_t>(stream >> 32);
+    uint32_t w0[batch], w1[batch], w2[batch], w3[batch];
+    for (size_t done = 0; done < n; done += batch) {
+        size_t count = n - done < batch ? n - done : batch;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t c = first + done + i;
+            uint32_t ctr[4] = { static_cast<uint32_t>(c), static_cast<uint32_t>(c >> 32), s0, s1 };
+            philox4x32(ctr, k0, k1);
+            w0[i] = ctr[0];
+            w1[i] = ctr[1];
+            w2[i] = ctr[2];
+            w3[i] = ctr[3];
+        }
+        for (size_t i = 0; i < count; ++i) {
+            boxMuller(w0[i], w1[i], z0[done + i], z1[done + i]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            boxMuller(w2[i], w3[i], z2[done + i], z3[done + i]);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef PHILOX_HPP
+#define PHILOX_HPP
+
+#include <cstddef>
+#include <stdint.h>
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3", SC'11). The output is a pure function of a 128-bit counter and a 64-bit
+// key, so any draw can be produced on its own, in any order and on any thread.
+inline void philox4x32(uint32_t ctr[4], uint32_t k0, uint32_t k1) {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    for (int round = 0; round < 10; ++round) {
+        uint64_t p0 = uint64_t(0xD2511F53u) * c0;
+        uint64_t p1 = uint64_t(0xCD9E8D57u) * c2;
+        uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c0 = n0;
+        c1 = static_cast<uint32_t>(p1);
+        c2 = n2;
+        c3 = static_cast<uint32_t>(p0);
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    ctr[0] = c0;
+    ctr[1] = c1;
+    ctr[2] = c2;
+    ctr[3] = c3;
+}
+
+// Four standard normals z0[i] .. z3[i] for the counter (first + i, stream),
+// i < n, under key seed: the four words of one Philox block make two
+// Box-Muller pairs, with log, sin and cos evaluated in single precision by
+// polynomials so the whole batch vectorises. The result for a given
+// (seed, stream, first + i) does not depend on n.
+void philoxNormals(uint64_t seed, uint64_t stream, uint64_t first, size_t n, double* z0, double* z1, double* z2,
+                   double* z3);
+
+#endif // PHILOX_HPP
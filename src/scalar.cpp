@@ -0,0 +1,41 @@
+#include "scalar.hpp"
+#include <limits>
+
+#ifdef SIM_HAVE_FLOAT128
+
+namespace {
+
+// 2 * atanh(z) for |z| <= 0.172, where the series gains 1.5 digits per term
+__float128 twiceAtanh(__float128 z) {
+    __float128 z2 = z * z, term = z, sum = 0;
+    for (int k = 0; k < 60; ++k) {
+        __float128 add = term / (2 * k + 1);
+        sum += add;
+        if (add == 0 || (add < 0 ? -add : add) < 1e-36 * (sum < 0 ? -sum : sum)) {
+            break;
+        }
+        term *= z2;
+    }
+    return 2 * sum;
+}
+
+}
+
+__float128 scalarLog(__float128 x) {
+    if (!(x > 0)) {
+        return x == 0 ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+    }
+    static const __float128 ln2 = twiceAtanh(__float128(1) / 3);
+
+    // x = m * 2^e with m in [sqrt(1/2), sqrt(2)); scaling by a power of two is exact
+    int e;
+    std::frexp(static_cast<long double>(x), &e);
+    __float128 m = x * static_cast<__float128>(std::ldexp(1.0L, -e));
+    if (m < __float128(0.70710678118654752440L)) {
+        m *= 2;
+        --e;
+    }
+    return twiceAtanh((m - 1) / (m + 1)) + e * ln2;
+}
+
+#endif
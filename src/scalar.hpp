@@ -0,0 +1,22 @@
+#ifndef SCALAR_HPP
+#define SCALAR_HPP
+
+#include <cmath>
+
+// Math used by the engine for every scalar type it is instantiated with.
+// Dual numbers add their own overloads in dual.hpp.
+
+#if defined(__SIZEOF_FLOAT128__)
+#define SIM_HAVE_FLOAT128 1
+#endif
+
+inline float scalarLog(float x) { return std::log(x); }
+inline double scalarLog(double x) { return std::log(x); }
+inline long double scalarLog(long double x) { return std::log(x); }
+
+#ifdef SIM_HAVE_FLOAT128
+// Natural log in full quad precision, without a libquadmath dependency.
+__float128 scalarLog(__float128 x);
+#endif
+
+#endif // SCALAR_HPP
@@ -0,0 +1,30 @@
+#include "sensitivity.hpp"
+
+SensitivitySimulation::SensitivitySimulation(double x0, double y0, double A, double B, double C, double D, double deltat)
+    : deltat(deltat),
+      model(x0, y0,
+            ParameterDual::variable(A, ParameterA), ParameterDual::variable(B, ParameterB),
+            ParameterDual::variable(C, ParameterC), ParameterDual::variable(D, ParameterD), deltat) {
+    x_values.push_back(model.getX());
+    y_values.push_back(model.getY());
+    H_values.push_back(getH());
+}
+
+void SensitivitySimulation::runSimulation(double totalTime) {
+    int steps = static_cast<int>(totalTime / deltat);
+    x_values.reserve(x_values.size() + steps);
+    y_values.reserve(y_values.size() + steps);
+    H_values.reserve(H_values.size() + steps);
+    for (int i = 0; i < steps; ++i) {
+        model.evolve();
+        ParameterDual abs_x = model.getX();
+        ParameterDual abs_y = model.getY();
+        x_values.push_back(abs_x);
+        y_values.push_back(abs_y);
+        H_values.push_back(model.calculateH(abs_x, abs_y));
+    }
+}
+
+ParameterDual SensitivitySimulation::getH() const {
+    return model.calculateH(model.getX(), model.getY());
+}
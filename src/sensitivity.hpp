@@ -0,0 +1,36 @@
+#ifndef SENSITIVITY_HPP
+#define SENSITIVITY_HPP
+
+#include "dual.hpp"
+#include "lotka_volterra.hpp"
+#include <vector>
+
+enum Parameter { ParameterA, ParameterB, ParameterC, ParameterD };
+
+// Value plus exact derivatives with respect to A, B, C, D.
+typedef Dual<4> ParameterDual;
+
+// Runs the same Euler update as Simulation over dual numbers, so one run gives
+// x, y and H together with their derivatives with respect to all four
+// parameters along the whole trajectory.
+class SensitivitySimulation {
+public:
+    SensitivitySimulation(double x0, double y0, double A, double B, double C, double D, double deltat);
+
+    void runSimulation(double totalTime);
+
+    ParameterDual getX() const { return model.getX(); }
+    ParameterDual getY() const { return model.getY(); }
+    ParameterDual getH() const;
+
+    const std::vector<ParameterDual>& getXValues() const { return x_values; }
+    const std::vector<ParameterDual>& getYValues() const { return y_values; }
+    const std::vector<ParameterDual>& getHValues() const { return H_values; }
+
+private:
+    double deltat;
+    LotkaVolterra<ParameterDual> model;
+    std::vector<ParameterDual> x_values, y_values, H_values;
+};
+
+#endif // SENSITIVITY_HPP
@@ -0,0 +1,142 @@
+#include "stochastic.hpp"
+#include "philox.hpp"
+#include "vectorize.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+const size_t blockSize = ensembleBlockSize;
+
+}
+
+StochasticEnsemble::StochasticEnsemble(const std::vector<EnsembleMember>& members, double deltat, double sigmaX,
+                                       double sigmaY, SdeScheme scheme, uint64_t seed)
+    : members(members), deltat(deltat), sigmaX(sigmaX), sigmaY(sigmaY), scheme(scheme), seed(seed), steps(0),
+      generation(0), jobSteps(0), jobStride(1), unfinished(0), stopping(false) {
+    x.resize(members.size());
+    y.resize(members.size());
+    for (size_t i = 0; i < members.size(); ++i) {
+        x[i] = members[i].x0;
+        y[i] = members[i].y0;
+    }
+}
+
+StochasticEnsemble::~StochasticEnsemble() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t w = 0; w < workers.size(); ++w) {
+        workers[w].join();
+    }
+}
+
+void StochasticEnsemble::noise(size_t i, long s, double& z0, double& z1) const {
+    double z[4];
+    philoxNormals(seed, static_cast<uint64_t>(s) >> 1, i, 1, &z[0], &z[1], &z[2], &z[3]);
+    z0 = z[2 * (s & 1)];
+    z1 = z[2 * (s & 1) + 1];
+}
+
+// Euler-Maruyama adds sigma x dW to the Euler step; for the diagonal noise
+// g(x) = sigma x, Milstein adds g g' (dW^2 - dt) / 2 = sigma^2 x (dW^2 - dt) / 2,
+// which raises the strong order from 1/2 to 1.
+void StochasticEnsemble::runBlock(size_t begin, size_t end, long n) {
+    double a[blockSize], b[blockSize], c[blockSize], d[blockSize], fx[blockSize], fy[blockSize], z[4][blockSize];
+    double* xs = &x[begin];
+    double* ys = &y[begin];
+    size_t count = end - begin;
+    for (size_t i = 0; i < count; ++i) {
+        const EnsembleMember& m = members[begin + i];
+        a[i] = m.A * deltat;
+        b[i] = m.B * deltat;
+        c[i] = m.C * deltat;
+        d[i] = m.D * deltat;
+        // Ensemble's floor, 1e-6 of the equilibrium (D / C, A / B), or 1e-6
+        // itself for members without one (e.g. prey alone with B = C = 0)
+        fx[i] = m.C > 0 ? 1e-6 * m.D / m.C : 1e-6;
+        fy[i] = m.B > 0 ? 1e-6 * m.A / m.B : 1e-6;
+    }
+    const double root = std::sqrt(deltat), dt = deltat, sx = sigmaX, sy = sigmaY;
+    const double mx = scheme == Milstein ? 0.5 * sigmaX * sigmaX : 0.0;
+    const double my = scheme == Milstein ? 0.5 * sigmaY * sigmaY : 0.0;
+    for (long s = 0; s < n;) {
+        // one Philox counter covers an even step and the odd one after it
+        uint64_t step = static_cast<uint64_t>(steps + s);
+        philoxNormals(seed, step >> 1, begin, count, z[0], z[1], z[2], z[3]);
+        for (size_t half = step & 1; half < 2 && s < n; ++half, ++s) {
+            const double* z0 = z[2 * half];
+            const double* z1 = z[2 * half + 1];
+            SIM_IVDEP
+            for (size_t i = 0; i < count; ++i) {
+                double xi = xs[i], yi = ys[i];
+                double wx = root * z0[i], wy = root * z1[i];
+                double nx = xi + ((a[i] - b[i] * yi) + sx * wx + mx * (wx * wx - dt)) * xi;
+                double ny = yi + ((c[i] * xi - d[i]) + sy * wy + my * (wy * wy - dt)) * yi;
+                xs[i] = nx > 0 ? nx : fx[i];
+                ys[i] = ny > 0 ? ny : fy[i];
+            }
+        }
+    }
+}
+
+void StochasticEnsemble::runShare(size_t worker, size_t stride, long n) {
+    for (size_t begin = worker * blockSize; begin < members.size(); begin += stride * blockSize) {
+        runBlock(begin, std::min(begin + blockSize, members.size()), n);
+    }
+}
+
+void StochasticEnsemble::work(size_t worker, unsigned long seen) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        while (!stopping && generation == seen) {
+            wake.wait(lock);
+        }
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        if (worker >= jobStride) {
+            // the pool is larger than this job needs
+            continue;
+        }
+        long n = jobSteps;
+        size_t stride = jobStride;
+        lock.unlock();
+        runShare(worker, stride, n);
+        lock.lock();
+        if (--unfinished == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+void StochasticEnsemble::run(long n, int threads) {
+    size_t blocks = (members.size() + blockSize - 1) / blockSize;
+    size_t stride = std::max<size_t>(1, std::min<size_t>(threads > 0 ? threads : 1, blocks));
+    if (stride == 1) {
+        runShare(0, 1, n);
+        steps += n;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (workers.size() + 1 < stride) {
+            workers.push_back(std::thread(&StochasticEnsemble::work, this, workers.size() + 1, generation));
+        }
+        jobSteps = n;
+        jobStride = stride;
+        unfinished = stride - 1;
+        ++generation;
+    }
+    wake.notify_all();
+    runShare(0, stride, n);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (unfinished > 0) {
+        finished.wait(lock);
+    }
+    steps += n;
+}
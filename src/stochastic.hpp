@@ -0,0 +1,69 @@
+#ifndef STOCHASTIC_HPP
+#define STOCHASTIC_HPP
+
+#include "ensemble.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+enum SdeScheme { EulerMaruyama, Milstein };
+
+// Lotka-Volterra with multiplicative environmental noise,
+//   dx = (A - B y) x dt + sigmaX x dW1
+//   dy = (C x - D) y dt + sigmaY y dW2
+// for many members at once, stored as structure of arrays like Ensemble.
+// Member i takes its increments for steps 2k and 2k + 1 from the four normals
+// of the Philox counter (i, k) under seed, so each trajectory is the same
+// whatever the number of threads and however the steps are split between
+// calls to run. The normals of a whole block are drawn before it steps. They
+// come from 31-bit uniforms through a single-precision Box-Muller transform
+// (philoxNormals), so they agree with the double formula to about 1e-6 and
+// are cut off at |z| < 6.7: tails beyond that never occur.
+class StochasticEnsemble {
+public:
+    StochasticEnsemble(const std::vector<EnsembleMember>& members, double deltat, double sigmaX, double sigmaY,
+                       SdeScheme scheme = Milstein, uint64_t seed = 1);
+    ~StochasticEnsemble();
+
+    // With threads > 1 the blocks are shared between the calling thread and
+    // threads - 1 workers, which are started on first use and kept for later
+    // calls.
+    void run(long steps, int threads = 1);
+
+    size_t size() const { return members.size(); }
+    long getSteps() const { return steps; }
+    double getX(size_t i) const { return x[i]; }
+    double getY(size_t i) const { return y[i]; }
+
+    // the standard normals behind member i's increments at step s: dW = sqrt(deltat) z
+    void noise(size_t i, long s, double& z0, double& z1) const;
+
+private:
+    StochasticEnsemble(const StochasticEnsemble&);
+    StochasticEnsemble& operator=(const StochasticEnsemble&);
+
+    void runBlock(size_t begin, size_t end, long n);
+    void runShare(size_t worker, size_t stride, long n);
+    void work(size_t worker, unsigned long seen);
+
+    std::vector<EnsembleMember> members;
+    double deltat, sigmaX, sigmaY;
+    SdeScheme scheme;
+    uint64_t seed;
+    long steps;
+    std::vector<double> x, y;
+
+    // worker pool; worker w (from 1, the caller is 0) steps blocks w, w + stride, ...
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    unsigned long generation;  // counts the jobs handed to the pool
+    long jobSteps;
+    size_t jobStride, unfinished;
+    bool stopping;
+};
+
+#endif // STOCHASTIC_HPP
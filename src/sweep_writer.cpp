@@ -0,0 +1,494 @@
+#include "sweep_writer.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SIM_HAVE_IO_URING 1
+#endif
+#endif
+
+#include <fcntl.h>
+#ifdef SIM_HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t alignment = 4096;
+
+// EAGAIN/EBUSY from io_uring_enter are retried this many times, waiting
+// 1, 2, 4 ... ms for completions in between, before the ring is dropped
+const int busyRetries = 8;
+
+#ifdef SIM_HAVE_IO_URING
+unsigned loadAcquire(const unsigned* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void storeRelease(unsigned* p, unsigned v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+// the chunk index and the file slot travel in the completion's user_data
+uint64_t tag(size_t file, size_t buffer) {
+    return (static_cast<uint64_t>(file) << 32) | buffer;
+}
+#endif
+
+int openOutput(const std::string& filename, bool direct) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    return ::open(filename.c_str(), direct ? flags | O_DIRECT : flags, 0644);
+}
+
+}
+
+SweepWriter::SweepWriter(WriterBackend backend, size_t queueDepth, size_t bufferSize, bool direct)
+    : backend(backend), direct(direct), bufferSize((bufferSize + alignment - 1) / alignment * alignment), ring(-1),
+      sqMap(MAP_FAILED), cqMap(MAP_FAILED), sqeMap(MAP_FAILED), sqMapSize(0), cqMapSize(0), sqeMapSize(0),
+      pending(0), waiting(false), entering(0), ringFailed(false), buffers(0), files(0), bytes(0), syscalls(0),
+      directFiles(0), errors(0) {
+    if (this->bufferSize == 0) {
+        this->bufferSize = alignment;
+    }
+    if (backend == WriterIoUring && !setupRing(queueDepth > 0 ? queueDepth : 1)) {
+        this->backend = WriterPwrite;
+    }
+}
+
+SweepWriter::~SweepWriter() {
+    flush();
+    if (sqeMap != MAP_FAILED) {
+        munmap(sqeMap, sqeMapSize);
+    }
+    if (cqMap != MAP_FAILED && cqMap != sqMap) {
+        munmap(cqMap, cqMapSize);
+    }
+    if (sqMap != MAP_FAILED) {
+        munmap(sqMap, sqMapSize);
+    }
+    if (ring >= 0) {
+        ::close(ring);
+    }
+    std::free(buffers);
+}
+
+#ifdef SIM_HAVE_IO_URING
+bool SweepWriter::setupRing(size_t queueDepth) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(queueDepth), &params));
+    if (ring < 0) {
+        return false;
+    }
+
+    sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sqMapSize = cqMapSize = sqMapSize > cqMapSize ? sqMapSize : cqMapSize;
+    }
+    sqMap = mmap(0, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED) {
+        return false;
+    }
+    cqMap = (params.features & IORING_FEAT_SINGLE_MMAP)
+                ? sqMap
+                : mmap(0, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+    sqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqeMap = mmap(0, sqeMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+    if (cqMap == MAP_FAILED || sqeMap == MAP_FAILED) {
+        return false;
+    }
+
+    char* sq = static_cast<char*>(sqMap);
+    char* cq = static_cast<char*>(cqMap);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    sqes = sqeMap;
+    cqes = cq + params.cq_off.cqes;
+
+    // one registered buffer per submission queue entry, so the queue never overflows
+    size_t count = params.sq_entries;
+    if (posix_memalign(reinterpret_cast<void**>(&buffers), alignment, count * bufferSize) != 0) {
+        buffers = 0;
+        return false;
+    }
+    std::vector<iovec> iovecs(count);
+    for (size_t i = 0; i < count; ++i) {
+        iovecs[i].iov_base = buffers + i * bufferSize;
+        iovecs[i].iov_len = bufferSize;
+        freeBuffers.push_back(count - 1 - i);
+    }
+    lengths.resize(count);
+    offsets.resize(count);
+    return syscall(__NR_io_uring_register, ring, IORING_REGISTER_BUFFERS, iovecs.data(),
+                   static_cast<unsigned>(count)) == 0;
+}
+#else
+bool SweepWriter::setupRing(size_t) {
+    return false;
+}
+#endif
+
+bool SweepWriter::writeFile(const std::string& filename, const std::string& contents) {
+    if (backend == WriterPwrite) {
+        return writeWithPwrite(filename, contents);
+    }
+
+    bool isDirect = direct;
+    int fd = openOutput(filename, isDirect);
+    if (fd < 0 && isDirect && errno == EINVAL) {
+        // filesystem without O_DIRECT support, e.g. tmpfs
+        isDirect = false;
+        fd = openOutput(filename, false);
+    }
+    if (fd < 0) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (ringFailed && !isDirect) {
+        lock.unlock();
+        ::close(fd);
+        return writeWithPwrite(filename, contents);
+    }
+    size_t file;
+    if (freeFiles.empty()) {
+        file = openFiles.size();
+        openFiles.push_back(OpenFile());
+    }
+    else {
+        file = freeFiles.back();
+        freeFiles.pop_back();
+    }
+    OpenFile& entry = openFiles[file];
+    entry.fd = fd;
+    entry.size = contents.size();
+    entry.outstanding = 0;
+    entry.queued = false;
+    entry.direct = isDirect;
+    ++files;
+    bytes += contents.size();
+    directFiles += isDirect ? 1 : 0;
+
+    for (size_t offset = 0; offset < contents.size(); offset += bufferSize) {
+        size_t length = contents.size() - offset < bufferSize ? contents.size() - offset : bufferSize;
+        size_t buffer = acquireBuffer(lock);
+        ++openFiles[file].outstanding;
+
+        // copy without holding the lock: the buffer is ours until its write completes
+        lock.unlock();
+        char* data = buffers + buffer * bufferSize;
+        std::memcpy(data, contents.data() + offset, length);
+        size_t padded = length;
+        if (isDirect && length % alignment) {
+            padded = (length + alignment - 1) / alignment * alignment;
+            std::memset(data + length, 0, padded - length);
+        }
+        lock.lock();
+        if (queueWrite(file, buffer, padded, offset)) {
+            submit(lock);
+        }
+    }
+    openFiles[file].queued = true;
+    if (openFiles[file].outstanding == 0) {
+        finishFile(file);
+    }
+    return true;
+}
+
+#ifdef SIM_HAVE_IO_URING
+// takes a free registered buffer, submitting and reaping to make one free
+size_t SweepWriter::acquireBuffer(std::unique_lock<std::mutex>& lock) {
+    while (freeBuffers.empty()) {
+        if (pending > 0) {
+            waitForCompletion(lock);
+        }
+        else {
+            // every buffer is being filled by other threads
+            changed.wait(lock);
+        }
+    }
+    size_t buffer = freeBuffers.back();
+    freeBuffers.pop_back();
+    return buffer;
+}
+
+bool SweepWriter::queueWrite(size_t file, size_t buffer, size_t length, size_t offset) {
+    lengths[buffer] = length;
+    offsets[buffer] = offset;
+    if (ringFailed) {
+        writeChunk(file, buffer);
+        return false;
+    }
+    unsigned tail = *sqTail;
+    unsigned index = tail & *sqMask;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = openFiles[file].fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(buffers + buffer * bufferSize);
+    sqe->len = static_cast<unsigned>(length);
+    sqe->buf_index = static_cast<uint16_t>(buffer);
+    sqe->user_data = tag(file, buffer);
+    sqArray[index] = index;
+    storeRelease(sqTail, tail + 1);
+    ++pending;
+    changed.notify_all();
+
+    // batch: go to the kernel only when a quarter of the queue is waiting
+    return unsubmitted() * 4 >= freeBuffers.size() + pending;
+}
+
+// entries the kernel has not consumed from the submission queue
+unsigned SweepWriter::unsubmitted() const {
+    return *sqTail - loadAcquire(sqHead);
+}
+
+// Buffered writes reach the page cache during submission, so the call can
+// take a while and runs without the lock. Entries queued meanwhile are
+// complete before the tail moves past them, and the kernel serialises
+// concurrent submitters, so at worst a call finds fewer entries than asked.
+void SweepWriter::submit(std::unique_lock<std::mutex>& lock) {
+    for (int attempt = 0; !ringFailed; ++attempt) {
+        unsigned count = unsubmitted();
+        ++entering;
+        lock.unlock();
+        int error = enter(count, 0);
+        lock.lock();
+        --entering;
+        ++syscalls;
+        if (!waiting) {
+            reap();
+        }
+        changed.notify_all();
+        if (error == 0) {
+            return;
+        }
+        if ((error != EAGAIN && error != EBUSY) || attempt == busyRetries) {
+            abandonRing(lock);
+            return;
+        }
+        // the kernel is short of resources or the completion queue is full:
+        // give the waiting thread time to reap
+        changed.wait_for(lock, std::chrono::milliseconds(1 << attempt));
+    }
+}
+
+// Only the waiting thread reaps, so no other thread can take the completions
+// it waits for while it is in the kernel; the others wait for it to return.
+// Once the ring is dropped nobody enters the kernel and any thread reaps,
+// polling for the writes it had already taken.
+void SweepWriter::waitForCompletion(std::unique_lock<std::mutex>& lock) {
+    if (waiting) {
+        changed.wait(lock);
+        return;
+    }
+    if (ringFailed) {
+        reap();
+        if (pending > 0) {
+            changed.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        return;
+    }
+    waiting = true;
+    int error = 0;
+    for (int attempt = 0; ; ++attempt) {
+        unsigned count = unsubmitted();
+        ++entering;
+        lock.unlock();
+        error = enter(count, 1);
+        lock.lock();
+        --entering;
+        ++syscalls;
+        reap();
+        if (error == 0 || (error != EAGAIN && error != EBUSY) || attempt == busyRetries) {
+            break;
+        }
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1 << attempt));
+        lock.lock();
+    }
+    waiting = false;
+    changed.notify_all();
+    if (error != 0) {
+        abandonRing(lock);
+    }
+}
+
+int SweepWriter::enter(unsigned count, unsigned minComplete) {
+    int done;
+    do {
+        done = static_cast<int>(syscall(__NR_io_uring_enter, ring, count, minComplete,
+                                        minComplete ? IORING_ENTER_GETEVENTS : 0, 0, 0));
+    } while (done < 0 && errno == EINTR);
+    return done < 0 ? errno : 0;
+}
+
+void SweepWriter::reap() {
+    unsigned head = *cqHead;
+    unsigned tail = loadAcquire(cqTail);
+    bool freed = false;
+    for (; head != tail; ++head) {
+        const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(cqes) + (head & *cqMask);
+        size_t file = static_cast<size_t>(cqe->user_data >> 32);
+        size_t buffer = static_cast<size_t>(cqe->user_data & 0xffffffff);
+        --pending;
+        if (cqe->res == -ECANCELED) {
+            // the submitting thread exited before an io-wq worker ran the
+            // write; the buffer still holds the data, so queue it again
+            queueWrite(file, buffer, lengths[buffer], offsets[buffer]);
+            continue;
+        }
+        // a short write to a regular file means the disk is full
+        if (cqe->res < 0 || static_cast<size_t>(cqe->res) != lengths[buffer]) {
+            ++errors;
+        }
+        complete(file, buffer);
+        freed = true;
+    }
+    storeRelease(cqHead, head);
+    if (freed) {
+        changed.notify_all();
+    }
+}
+
+// Drops the ring after io_uring_enter failed for good. Once no other thread
+// is in the kernel, the entries it has not taken are written here with
+// pwrite; writes it had taken still complete through the completion queue.
+void SweepWriter::abandonRing(std::unique_lock<std::mutex>& lock) {
+    if (ringFailed) {
+        return;
+    }
+    ringFailed = true;
+    while (entering > 0 || waiting) {
+        changed.wait(lock);
+    }
+    unsigned tail = *sqTail;
+    for (unsigned head = loadAcquire(sqHead); head != tail; ++head) {
+        const io_uring_sqe* sqe = static_cast<const io_uring_sqe*>(sqes) + sqArray[head & *sqMask];
+        --pending;
+        writeChunk(static_cast<size_t>(sqe->user_data >> 32), static_cast<size_t>(sqe->user_data & 0xffffffff));
+    }
+    changed.notify_all();
+}
+#else
+// without io_uring support the backend is always WriterPwrite, so the ring
+// path below is never taken
+size_t SweepWriter::acquireBuffer(std::unique_lock<std::mutex>&) {
+    return 0;
+}
+
+bool SweepWriter::queueWrite(size_t, size_t, size_t, size_t) {
+    return false;
+}
+
+unsigned SweepWriter::unsubmitted() const {
+    return 0;
+}
+
+void SweepWriter::submit(std::unique_lock<std::mutex>&) {
+}
+
+void SweepWriter::waitForCompletion(std::unique_lock<std::mutex>&) {
+}
+
+void SweepWriter::enter(unsigned, unsigned) {
+}
+
+void SweepWriter::reap() {
+}
+
+void SweepWriter::abandonRing(std::unique_lock<std::mutex>&) {
+}
+#endif
+
+// one queued chunk written with pwrite, for a ring that has been dropped
+void SweepWriter::writeChunk(size_t file, size_t buffer) {
+    const char* data = buffers + buffer * bufferSize;
+    size_t length = lengths[buffer], written = 0;
+    while (written < length) {
+        ssize_t n = pwrite(openFiles[file].fd, data + written, length - written,
+                           static_cast<off_t>(offsets[buffer] + written));
+        ++syscalls;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ++errors;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    complete(file, buffer);
+    changed.notify_all();
+}
+
+void SweepWriter::complete(size_t file, size_t buffer) {
+    freeBuffers.push_back(buffer);
+    if (--openFiles[file].outstanding == 0 && openFiles[file].queued) {
+        finishFile(file);
+    }
+}
+
+void SweepWriter::finishFile(size_t file) {
+    OpenFile& entry = openFiles[file];
+    if (entry.direct && entry.size % alignment && ftruncate(entry.fd, static_cast<off_t>(entry.size)) != 0) {
+        ++errors;
+    }
+    ::close(entry.fd);
+    entry.fd = -1;
+    freeFiles.push_back(file);
+}
+
+void SweepWriter::flush() {
+    if (backend != WriterIoUring) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while (pending > 0 || waiting) {
+        waitForCompletion(lock);
+    }
+}
+
+bool SweepWriter::writeWithPwrite(const std::string& filename, const std::string& contents) {
+    int fd = openOutput(filename, false);
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0, calls = 0;
+    bool failed = false;
+    while (written < contents.size()) {
+        ssize_t n = pwrite(fd, contents.data() + written, contents.size() - written, static_cast<off_t>(written));
+        ++calls;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            failed = true;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    ::close(fd);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++files;
+    bytes += contents.size();
+    syscalls += calls;
+    errors += failed ? 1 : 0;
+    return !failed;
+}
@@ -0,0 +1,115 @@
+#ifndef SWEEP_WRITER_HPP
+#define SWEEP_WRITER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum WriterBackend { WriterPwrite, WriterIoUring };
+
+// Writes whole result files for the workers of a sweep. With WriterIoUring
+// all threads share one io_uring: file contents are copied into registered
+// buffers and queued as fixed-buffer writes, which are submitted to the
+// kernel in batches, so thousands of small files cost a few io_uring_enter
+// calls instead of a write each. With direct, files are opened with O_DIRECT
+// where the filesystem allows it (the last block is padded and truncated
+// back afterwards). If io_uring is not available (old kernel, seccomp, or
+// headers without linux/io_uring.h at build time) the writer falls back to
+// one pwrite loop per file. io_uring_enter failing with EAGAIN or EBUSY is
+// retried with a short backoff while completions are reaped; any other
+// failure, or a busy ring that does not recover, drops the ring: entries it
+// had not taken and every later chunk are written with pwrite, and getBackend
+// reports WriterPwrite from then on.
+//
+// pwrite is the default: in the sweep_output bench io_uring was not faster
+// (29.5 s against 27.2 s for an ofstream per file).
+//
+// The shared state is only touched under a mutex; the io_uring_enter calls
+// themselves run outside it. One thread at a time waits in the kernel for
+// completions and reaps them, the others wait for it to free buffers.
+class SweepWriter {
+public:
+    explicit SweepWriter(WriterBackend backend = WriterPwrite, size_t queueDepth = 64, size_t bufferSize = 1 << 16,
+                         bool direct = false);
+    ~SweepWriter();
+
+    WriterBackend getBackend() const { return ringFailed ? WriterPwrite : backend; }
+
+    // Thread safe. Returns false if the file cannot be opened, or if a pwrite
+    // fails; io_uring write errors are counted by getErrors once they complete.
+    bool writeFile(const std::string& filename, const std::string& contents);
+
+    // waits for every queued write and closes the files
+    void flush();
+
+    size_t getFiles() const { return files; }
+    size_t getBytes() const { return bytes; }
+    // io_uring_enter or pwrite calls
+    size_t getSyscalls() const { return syscalls; }
+    size_t getDirectFiles() const { return directFiles; }
+    size_t getErrors() const { return errors; }
+
+private:
+    SweepWriter(const SweepWriter&);
+    SweepWriter& operator=(const SweepWriter&);
+
+    struct OpenFile {
+        int fd;
+        size_t size;
+        size_t outstanding;  // writes not completed yet
+        bool queued;         // every chunk has been queued
+        bool direct;
+    };
+
+    bool setupRing(size_t queueDepth);
+    bool writeWithPwrite(const std::string& filename, const std::string& contents);
+    size_t acquireBuffer(std::unique_lock<std::mutex>& lock);
+    // returns true when enough writes are queued to go to the kernel
+    bool queueWrite(size_t file, size_t buffer, size_t length, size_t offset);
+    // submit and wait for completions with the lock released
+    void submit(std::unique_lock<std::mutex>& lock);
+    void waitForCompletion(std::unique_lock<std::mutex>& lock);
+    unsigned unsubmitted() const;
+    // 0, or the errno of a failed call
+    int enter(unsigned count, unsigned minComplete);
+    void reap();
+    void abandonRing(std::unique_lock<std::mutex>& lock);
+    void writeChunk(size_t file, size_t buffer);
+    void complete(size_t file, size_t buffer);
+    void finishFile(size_t file);
+
+    WriterBackend backend;
+    bool direct;
+    size_t bufferSize;
+
+    // ring, see io_uring(7)
+    int ring;
+    void* sqMap;
+    void* cqMap;
+    void* sqeMap;
+    size_t sqMapSize, cqMapSize, sqeMapSize;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    void* sqes;
+    void* cqes;
+    unsigned pending;  // writes queued and not reaped yet
+    bool waiting;  // a thread is in io_uring_enter for completions; only it reaps
+    unsigned entering;  // threads in io_uring_enter
+    std::atomic<bool> ringFailed;  // io_uring_enter failed for good, see abandonRing
+
+    char* buffers;
+    std::vector<size_t> freeBuffers;
+    std::vector<size_t> lengths;  // of the write queued from each buffer
+    std::vector<size_t> offsets;
+    std::vector<OpenFile> openFiles;
+    std::vector<size_t> freeFiles;
+
+    std::mutex mutex;
+    std::condition_variable changed;  // a buffer was queued or freed, or the waiter returned
+    size_t files, bytes, syscalls, directFiles, errors;
+};
+
+#endif // SWEEP_WRITER_HPP
@@ -0,0 +1,217 @@
+#include "trace.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace trace {
+
+std::atomic<bool> enabled(false);
+
+namespace {
+
+struct Event {
+    const char* name;
+    unsigned long long begin, end;
+};
+
+// Events are appended to a list of fixed-size chunks that never move. Only
+// the owning thread writes: it fills a slot, then publishes it by storing
+// the chunk's count with release order, and links a new chunk the same way.
+// Readers follow the links and counts with acquire loads and copy only
+// published slots, so neither side ever takes a lock.
+struct Chunk {
+    static const size_t capacity = 1024;
+    Event events[capacity];
+    std::atomic<size_t> count;
+    std::atomic<Chunk*> next;
+
+    Chunk() : count(0), next(0) {}
+};
+
+class ThreadBuffer {
+public:
+    ThreadBuffer() : tid(0), first(new Chunk), last(first) {}
+    ~ThreadBuffer() {
+        for (Chunk* c = first; c;) {
+            Chunk* next = c->next.load(std::memory_order_relaxed);
+            delete c;
+            c = next;
+        }
+    }
+
+    // owning thread only
+    void append(const Event& event) {
+        size_t n = last->count.load(std::memory_order_relaxed);
+        if (n == Chunk::capacity) {
+            Chunk* chunk = new Chunk;
+            last->next.store(chunk, std::memory_order_release);
+            last = chunk;
+            n = 0;
+        }
+        last->events[n] = event;
+        last->count.store(n + 1, std::memory_order_release);
+    }
+
+    // any thread: the events published so far
+    void copy(std::vector<Event>& out) const {
+        out.clear();
+        for (const Chunk* c = first; c; c = c->next.load(std::memory_order_acquire)) {
+            size_t n = c->count.load(std::memory_order_acquire);
+            out.insert(out.end(), c->events, c->events + n);
+        }
+    }
+
+    int tid;
+
+private:
+    ThreadBuffer(const ThreadBuffer&);
+    ThreadBuffer& operator=(const ThreadBuffer&);
+
+    Chunk* first;
+    Chunk* last;  // written by the owning thread only
+};
+
+const size_t Chunk::capacity;
+
+// Buffers are shared with the registry so events survive their thread.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer> > buffers;
+    unsigned long long originTicks;
+    std::chrono::steady_clock::time_point originTime;
+    std::string exitFile;
+
+    Registry() : originTicks(0) {
+        const char* env = std::getenv("SIM_TRACE");
+        if (env && *env) {
+            exitFile = env;
+        }
+    }
+
+    ~Registry() {
+        if (!exitFile.empty()) {
+            writeChromeTrace(exitFile);
+        }
+    }
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadBuffer& threadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        buffer->tid = static_cast<int>(r.buffers.size()) + 1;
+        r.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+// event names are string literals, but may still hold quotes or backslashes
+void writeJsonString(std::ostream& os, const char* s) {
+    static const char hex[] = "0123456789abcdef";
+    os << '"';
+    for (; *s; ++s) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') {
+            os << '\\' << *s;
+        }
+        else if (c < 0x20) {
+            os << "\\u00" << hex[c >> 4] << hex[c & 15];
+        }
+        else {
+            os << *s;
+        }
+    }
+    os << '"';
+}
+
+// starts tracing before main when SIM_TRACE is set
+struct AutoStart {
+    AutoStart() {
+        if (!registry().exitFile.empty()) {
+            start();
+        }
+    }
+} autoStart;
+
+}
+
+unsigned long long now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void record(const char* name, unsigned long long begin, unsigned long long end) {
+    Event event = { name, begin, end };
+    threadBuffer().append(event);
+}
+
+void start() {
+    Registry& r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (r.originTicks == 0) {
+            r.originTime = std::chrono::steady_clock::now();
+            r.originTicks = now();
+        }
+    }
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void stop() {
+    enabled.store(false, std::memory_order_relaxed);
+}
+
+bool writeChromeTrace(const std::string& filename) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    // ticks per microsecond, calibrated over the whole traced interval
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - r.originTime).count();
+    double ticksPerUs = elapsed > 0 ? (now() - r.originTicks) / elapsed : 1;
+    if (!(ticksPerUs > 0)) {
+        ticksPerUs = 1;
+    }
+
+    std::ofstream file(filename);
+    if (!file) {
+        return false;
+    }
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    std::vector<Event> events;
+    for (size_t b = 0; b < r.buffers.size(); ++b) {
+        const ThreadBuffer& buffer = *r.buffers[b];
+        buffer.copy(events);
+        for (size_t i = 0; i < events.size(); ++i) {
+            const Event& e = events[i];
+            file << (first ? "\n" : ",\n") << "{\"name\":";
+            writeJsonString(file, e.name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.tid
+                 << ",\"ts\":" << (static_cast<double>(e.begin) - r.originTicks) / ticksPerUs
+                 << ",\"dur\":" << (e.end - e.begin) / ticksPerUs << "}";
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+}
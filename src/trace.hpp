@@ -0,0 +1,52 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <string>
+
+// Scoped wall-time tracing exported as Chrome trace-event JSON (open it in
+// Perfetto or chrome://tracing). Each thread records into its own buffer with
+// TSC timestamps, with no lock after its first event: an event is a store into
+// a fixed-size chunk and a release store of its count, plus an allocation
+// every 1024 events.
+// writeChromeTrace copies the published events while threads keep recording.
+// When tracing is off a scope costs one relaxed load. Setting
+// SIM_TRACE=<file> traces the whole program and writes the file at exit.
+// Building with -DSIM_NO_TRACING removes the scopes.
+namespace trace {
+
+extern std::atomic<bool> enabled;
+
+void start();
+void stop();
+// writes every event recorded so far, while other threads may still be
+// recording; returns false if the file cannot be written
+bool writeChromeTrace(const std::string& filename);
+
+unsigned long long now();
+void record(const char* name, unsigned long long begin, unsigned long long end);
+
+class Scope {
+public:
+    explicit Scope(const char* name)
+        : name(name), begin(enabled.load(std::memory_order_relaxed) ? now() : 0) {}
+    ~Scope() {
+        if (begin != 0) record(name, begin, now());
+    }
+
+private:
+    const char* name;
+    unsigned long long begin;
+};
+
+}
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#ifdef SIM_NO_TRACING
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#endif
+
+#endif // TRACE_HPP
@@ -0,0 +1,17 @@
+#ifndef VECTORIZE_HPP
+#define VECTORIZE_HPP
+
+#include <cstddef>
+
+// Ensembles step their members in blocks of this many, so the per-block
+// parameter and scratch arrays stay in L1 while every step runs over them.
+const size_t ensembleBlockSize = 512;
+
+// members never alias each other, so the per-member loops are vectorisable
+#if defined(__GNUC__) && !defined(__clang__)
+#define SIM_IVDEP _Pragma("GCC ivdep")
+#else
+#define SIM_IVDEP
+#endif
+
+#endif // VECTORIZE_HPP
@@ -0,0 +1,148 @@
+// Performance regression tests. Each workload runs in a forked child so the
+// RSS it adds can be read apart from the test runner's (see measure.hpp). A
+// workload fails when its median time exceeds the baseline by more than the
+// margin plus three median absolute deviations, or when the peak RSS it adds
+// exceeds the baseline by more than the margin.
+//
+// The reference baseline is versioned as test/perf_baseline.txt ($PERF_BASELINE
+// reads another file). A workload missing from it fails; PERF_UPDATE_BASELINE=1
+// records every workload instead, which is how the file is refreshed when the
+// reference machine changes or a slowdown is accepted. The margin defaults to
+// 25% and can be changed with PERF_MARGIN=0.1 and similar.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "header.hpp"
+#include "measure.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Measurement {
+    double median;
+    double mad;
+    long peakRssKb;  // above the RSS inherited at the fork
+};
+
+struct BaselineEntry {
+    double median;
+    long peakRssKb;
+};
+
+std::string baselinePath() {
+    const char* env = std::getenv("PERF_BASELINE");
+    if (env && *env) {
+        return env;
+    }
+    return SIM_PERF_BASELINE;
+}
+
+double margin() {
+    const char* env = std::getenv("PERF_MARGIN");
+    return env ? std::atof(env) : 0.25;
+}
+
+std::map<std::string, BaselineEntry> loadBaseline() {
+    std::map<std::string, BaselineEntry> baseline;
+    std::ifstream file(baselinePath().c_str());
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        BaselineEntry entry;
+        if (!line.empty() && line[0] != '#' && fields >> name >> entry.median >> entry.peakRssKb) {
+            baseline[name] = entry;
+        }
+    }
+    return baseline;
+}
+
+void storeBaseline(const std::string& name, const Measurement& m) {
+    std::map<std::string, BaselineEntry> baseline = loadBaseline();
+    BaselineEntry entry = { m.median, m.peakRssKb };
+    baseline[name] = entry;
+    std::ofstream file(baselinePath().c_str());
+    file << "# workload, median seconds, peak RSS added in kB; written with PERF_UPDATE_BASELINE=1\n";
+    for (std::map<std::string, BaselineEntry>::const_iterator it = baseline.begin(); it != baseline.end(); ++it) {
+        file << it->first << " " << it->second.median << " " << it->second.peakRssKb << "\n";
+    }
+}
+
+// Runs workload repetitions times in a child process.
+Measurement measure(void (*workload)(), int repetitions) {
+    Measurement m = { 0, 0, 0 };
+    std::vector<double> times;
+    long peakRssKb, forkRssKb;
+    REQUIRE(measureInChild(workload, repetitions, times, peakRssKb, forkRssKb));
+    m.peakRssKb = peakRssKb - forkRssKb;
+
+    std::sort(times.begin(), times.end());
+    m.median = times[times.size() / 2];
+    std::vector<double> deviations;
+    for (size_t i = 0; i < times.size(); ++i) {
+        deviations.push_back(std::fabs(times[i] - m.median));
+    }
+    std::sort(deviations.begin(), deviations.end());
+    m.mad = deviations[deviations.size() / 2];
+    return m;
+}
+
+void checkAgainstBaseline(const std::string& name, const Measurement& m) {
+    MESSAGE(name << ": median " << m.median << " s, mad " << m.mad << " s, added RSS " << m.peakRssKb << " kB");
+
+    const char* update = std::getenv("PERF_UPDATE_BASELINE");
+    if (update && std::string(update) == "1") {
+        storeBaseline(name, m);
+        MESSAGE(name << ": baseline recorded in " << baselinePath());
+        return;
+    }
+    std::map<std::string, BaselineEntry> baseline = loadBaseline();
+    if (baseline.find(name) == baseline.end()) {
+        FAIL(name << " has no baseline in " << baselinePath() << "; record it with PERF_UPDATE_BASELINE=1");
+    }
+
+    const BaselineEntry& base = baseline[name];
+    double limit = base.median * (1 + margin()) + 3 * m.mad;
+    CHECK_MESSAGE(m.median <= limit, name << " is slower than the baseline " << base.median << " s");
+    CHECK_MESSAGE(m.peakRssKb <= base.peakRssKb * (1 + margin()),
+                  name << " uses more memory than the baseline " << base.peakRssKb << " kB");
+}
+
+void defaultCase() {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    sim.runSimulation(17.0);
+}
+
+void longRun() {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    sim.runSimulation(10000.0);
+}
+
+void sweep() {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    for (int i = 0; i < 1000; ++i) {
+        sim.reset(1200.0, 1000.0, 1.5 + 0.001 * i, 0.02, 0.01, 1.0, 0.001);
+        sim.runSimulation(17.0);
+    }
+}
+
+}
+
+TEST_CASE("perf: default 17 time unit run") {
+    checkAgainstBaseline("default_17", measure(defaultCase, 51));
+}
+
+TEST_CASE("perf: 10^7 step run") {
+    checkAgainstBaseline("steps_1e7", measure(longRun, 3));
+}
+
+TEST_CASE("perf: 1000 point sweep") {
+    checkAgainstBaseline("sweep_1000", measure(sweep, 3));
+}
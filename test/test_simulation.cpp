@@ -1,6 +1,39 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 #include "header.hpp"
+#include "events.hpp"
+#include "cycle.hpp"
+#include "fit.hpp"
+#include "sensitivity.hpp"
+#include "adjoint.hpp"
+#include "downsample.hpp"
+#include "spsc_ring.hpp"
+#include "batch.hpp"
+#include "trace.hpp"
+#include "memory.hpp"
+#include "engine.hpp"
+#include "ensemble.hpp"
+#include "compressed.hpp"
+#include "lossy.hpp"
+#include "async_writer.hpp"
+#include "sweep_writer.hpp"
+#include "models.hpp"
+#include "delay.hpp"
+#include "stochastic.hpp"
+#include "philox.hpp"
+#include "live_plot.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
 
 TEST_CASE("Simulation calculates values correctly with 5% tolerance") {
     // Define initial parameters
@@ -44,3 +77,1075 @@ TEST_CASE("Simulation calculates values correctly with 5% tolerance") {
     CHECK(y_values[1] == doctest::Approx(1011).epsilon(0.05));   // y at index 1
     CHECK(H_values[1] == doctest::Approx(11.0947).epsilon(0.05)); // H at index 1
 }
+
+TEST_CASE("EventDetector measures period and extrema during the run") {
+    // Small orbit around the equilibrium (D/C, A/B) = (100, 100)
+    double A = 2.0, B = 0.02, C = 0.01, D = 1.0;
+    Simulation sim(105.0, 100.0, A, B, C, D, 0.0001);
+
+    EventDetector events;
+    int threshold = events.addThreshold(Prey, 100.0);
+    events.addSection(0.0, 1.0, A / B, 1);
+    sim.addObserver(&events);
+    sim.runSimulation(20.0);
+
+    // Linearised period 2*pi/sqrt(A*D)
+    double expected = 2 * 3.14159265358979 / std::sqrt(A * D);
+    REQUIRE(events.getCycleCount() >= 3);
+    CHECK(events.getPeriod() == doctest::Approx(expected).epsilon(0.01));
+    CHECK(events.getPreyMax() == doctest::Approx(105.0).epsilon(0.01));
+    CHECK(events.getPreyMin() == doctest::Approx(95.0).epsilon(0.01));
+    CHECK(events.getPreyAmplitude() == doctest::Approx(5.0).epsilon(0.02));
+
+    // Prey peaks where dx/dt = 0, i.e. on the line y = A/B
+    const std::vector<Event>& log = events.getEvents();
+    for (size_t i = 0; i < log.size(); ++i) {
+        if (log[i].type == PreyMaximum) {
+            CHECK(log[i].y == doctest::Approx(A / B).epsilon(0.001));
+        }
+        if (log[i].type == ThresholdCrossing) {
+            CHECK(log[i].id == threshold);
+            CHECK(log[i].x == doctest::Approx(100.0).epsilon(1e-6));
+        }
+    }
+    CHECK(events.getEventCount(SectionHit) >= events.getCycleCount());
+}
+
+TEST_CASE("Cycle statistics from the H level set match the integrated orbit") {
+    double A = 2.0, B = 0.02, C = 0.01, D = 1.0;
+
+    // Near the equilibrium the period tends to 2*pi/sqrt(A*D)
+    CycleStatistics small = computeCycleStatistics(A, B, C, D, 100.01, 100.0);
+    CHECK(small.period == doctest::Approx(2 * 3.14159265358979 / std::sqrt(A * D)).epsilon(1e-4));
+
+    // Time averages over a cycle equal the equilibrium, extremes lie on the level set
+    CycleStatistics big = computeCycleStatistics(A, B, C, D, 1200.0, 1000.0);
+    CHECK(big.xMean == doctest::Approx(D / C).epsilon(1e-9));
+    CHECK(big.yMean == doctest::Approx(A / B).epsilon(1e-9));
+    Simulation probe(1200.0, 1000.0, A, B, C, D, 0.001);
+    CHECK(probe.calculateH(big.xMax, A / B) == doctest::Approx(big.H).epsilon(1e-12));
+    CHECK(probe.calculateH(big.xMin, A / B) == doctest::Approx(big.H).epsilon(1e-12));
+    CHECK(probe.calculateH(D / C, big.yMax) == doctest::Approx(big.H).epsilon(1e-12));
+    CHECK(probe.calculateH(D / C, big.yMin) == doctest::Approx(big.H).epsilon(1e-12));
+
+    // Agrees with the period measured on a finely stepped run
+    CycleStatistics mid = computeCycleStatistics(A, B, C, D, 150.0, 100.0);
+    Simulation sim(150.0, 100.0, A, B, C, D, 0.00001);
+    EventDetector events;
+    sim.addObserver(&events);
+    sim.runSimulation(2.5 * mid.period);
+    REQUIRE(events.getCycleCount() >= 1);
+    CHECK(events.getLastPeriod() == doctest::Approx(mid.period).epsilon(0.002));
+    CHECK(events.getPreyMax() == doctest::Approx(mid.xMax).epsilon(0.002));
+
+    CHECK(computeCycleStatistics(A, B, C, D, -1.0, 100.0).period == -1);
+}
+
+TEST_CASE("Levenberg-Marquardt recovers parameters from a simulated series") {
+    double deltat = 0.001;
+    Simulation truth(80.0, 40.0, 1.5, 0.03, 0.012, 0.9, deltat);
+    truth.runSimulation(12.0);
+
+    std::vector<Observation> observations;
+    for (int k = 0; k <= 120; ++k) {
+        double t = 0.1 * k;
+        Observation obs = { t, truth.getXAtTime(t + deltat / 2), truth.getYAtTime(t + deltat / 2) };
+        observations.push_back(obs);
+    }
+
+    FitParameters guess = { 1.2, 0.04, 0.01, 1.1, 70.0, 50.0 };
+    FitOptions options;
+    options.deltat = deltat;
+    options.starts = 4;
+    options.threads = 2;
+    FitResult fit = fitParameters(observations, guess, options);
+
+    CHECK(fit.converged);
+    CHECK(fit.simulations < 400);
+    CHECK(fit.parameters.A == doctest::Approx(1.5).epsilon(1e-6));
+    CHECK(fit.parameters.B == doctest::Approx(0.03).epsilon(1e-6));
+    CHECK(fit.parameters.C == doctest::Approx(0.012).epsilon(1e-6));
+    CHECK(fit.parameters.D == doctest::Approx(0.9).epsilon(1e-6));
+    CHECK(fit.parameters.x0 == doctest::Approx(80.0).epsilon(1e-6));
+    CHECK(fit.parameters.y0 == doctest::Approx(40.0).epsilon(1e-6));
+
+    FitParameters zero = guess;
+    zero.C = 0;
+    CHECK_THROWS_AS(fitParameters(observations, zero, options), std::invalid_argument);
+    FitParameters negative = guess;
+    negative.y0 = -50.0;
+    CHECK_THROWS_AS(fitParameters(observations, negative, options), std::invalid_argument);
+}
+
+TEST_CASE("Dual-number run gives the parameter sensitivities of x, y and H") {
+    double p[4] = { 2.0, 0.02, 0.01, 1.0 };
+    double deltat = 0.001, totalTime = 3.0;
+
+    SensitivitySimulation dual(1200.0, 1000.0, p[0], p[1], p[2], p[3], deltat);
+    dual.runSimulation(totalTime);
+
+    Simulation plain(1200.0, 1000.0, p[0], p[1], p[2], p[3], deltat);
+    plain.runSimulation(totalTime);
+    CHECK(dual.getX().value == doctest::Approx(plain.getX()).epsilon(1e-12));
+    CHECK(dual.getH().value == doctest::Approx(plain.getH()).epsilon(1e-12));
+
+    // central differences on the ordinary simulation
+    for (int k = 0; k < 4; ++k) {
+        double h = 1e-6 * p[k];
+        double up[4] = { p[0], p[1], p[2], p[3] };
+        double down[4] = { p[0], p[1], p[2], p[3] };
+        up[k] += h;
+        down[k] -= h;
+        Simulation su(1200.0, 1000.0, up[0], up[1], up[2], up[3], deltat);
+        Simulation sd(1200.0, 1000.0, down[0], down[1], down[2], down[3], deltat);
+        su.runSimulation(totalTime);
+        sd.runSimulation(totalTime);
+        CHECK(dual.getX().grad[k] == doctest::Approx((su.getX() - sd.getX()) / (2 * h)).epsilon(1e-4));
+        CHECK(dual.getY().grad[k] == doctest::Approx((su.getY() - sd.getY()) / (2 * h)).epsilon(1e-4));
+        CHECK(dual.getH().grad[k] == doctest::Approx((su.getH() - sd.getH()) / (2 * h)).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("Adjoint gradient matches forward sensitivities under a checkpoint budget") {
+    double deltat = 0.001;
+    FitParameters p = { 2.0, 0.02, 0.01, 1.0, 120.0, 60.0 };
+    std::vector<Observation> observations;
+    for (int k = 1; k <= 10; ++k) {
+        Observation obs = { 0.5 * k, 100.0 + k, 90.0 - k };
+        observations.push_back(obs);
+    }
+    ObservationLoss loss(observations, deltat);
+
+    AdjointResult adjoint = computeAdjointGradient(p, deltat, 5.0, loss, 70);
+    CHECK(adjoint.checkpoints <= 70);
+    CHECK(adjoint.segmentLength * adjoint.checkpoints >= 5000);
+
+    SensitivitySimulation forward(p.x0, p.y0, p.A, p.B, p.C, p.D, deltat);
+    forward.runSimulation(5.0);
+    double expectedLoss = 0;
+    double expected[4] = { 0, 0, 0, 0 };
+    for (size_t k = 0; k < observations.size(); ++k) {
+        long n = std::lround(observations[k].t / deltat);
+        const ParameterDual& x = forward.getXValues()[n];
+        const ParameterDual& y = forward.getYValues()[n];
+        double rx = x.value - observations[k].x, ry = y.value - observations[k].y;
+        expectedLoss += 0.5 * (rx * rx + ry * ry);
+        for (int j = 0; j < 4; ++j) {
+            expected[j] += rx * x.grad[j] + ry * y.grad[j];
+        }
+    }
+    CHECK(adjoint.loss == doctest::Approx(expectedLoss).epsilon(1e-12));
+    CHECK(adjoint.gradient.A == doctest::Approx(expected[0]).epsilon(1e-8));
+    CHECK(adjoint.gradient.B == doctest::Approx(expected[1]).epsilon(1e-8));
+    CHECK(adjoint.gradient.C == doctest::Approx(expected[2]).epsilon(1e-8));
+    CHECK(adjoint.gradient.D == doctest::Approx(expected[3]).epsilon(1e-8));
+
+    // initial conditions by central differences
+    double h = 1e-4;
+    FitParameters up = p, down = p;
+    up.x0 += h;
+    down.x0 -= h;
+    double fd = (computeAdjointGradient(up, deltat, 5.0, loss, 70).loss -
+                 computeAdjointGradient(down, deltat, 5.0, loss, 70).loss) / (2 * h);
+    CHECK(adjoint.gradient.x0 == doctest::Approx(fd).epsilon(1e-5));
+}
+
+TEST_CASE("Adjoint stays within a checkpoint budget that divides the step count") {
+    double deltat = 0.001;
+    FitParameters p = { 2.0, 0.02, 0.01, 1.0, 120.0, 60.0 };
+    std::vector<Observation> observations;
+    for (int k = 1; k <= 10; ++k) {
+        Observation obs = { 0.5 * k, 100.0 + k, 90.0 - k };
+        observations.push_back(obs);
+    }
+    ObservationLoss loss(observations, deltat);
+
+    // 5000 steps in segments of 100: the last checkpoint is at step 4900
+    AdjointResult exact = computeAdjointGradient(p, deltat, 5.0, loss, 50);
+    CHECK(exact.segmentLength == 100);
+    CHECK(exact.checkpoints == 50);
+
+    AdjointResult dense = computeAdjointGradient(p, deltat, 5.0, loss, 5000);
+    CHECK(dense.checkpoints == 5000);
+    CHECK(exact.loss == doctest::Approx(dense.loss).epsilon(1e-14));
+    CHECK(exact.gradient.A == doctest::Approx(dense.gradient.A).epsilon(1e-12));
+    CHECK(exact.gradient.D == doctest::Approx(dense.gradient.D).epsilon(1e-12));
+    CHECK(exact.gradient.y0 == doctest::Approx(dense.gradient.y0).epsilon(1e-12));
+}
+
+TEST_CASE("Downsampling keeps endpoints and peaks of long series") {
+    std::vector<double> t, v;
+    for (int i = 0; i < 100000; ++i) {
+        t.push_back(i * 0.001);
+        v.push_back(std::sin(i * 0.001));
+    }
+    v[54321] = 5.0;  // isolated spike
+
+    std::vector<double> outT, outV;
+    downsample(t, v, 1000, LargestTriangle, outT, outV);
+    REQUIRE(outT.size() == 1000);
+    CHECK(outT.front() == t.front());
+    CHECK(outT.back() == t.back());
+    CHECK(*std::max_element(outV.begin(), outV.end()) == 5.0);
+    CHECK(std::adjacent_find(outT.begin(), outT.end(), std::greater_equal<double>()) == outT.end());
+
+    downsample(t, v, 1000, MinMax, outT, outV);
+    CHECK(outT.size() <= 1000);
+    CHECK(*std::max_element(outV.begin(), outV.end()) == 5.0);
+    CHECK(*std::min_element(outV.begin(), outV.end()) == *std::min_element(v.begin(), v.end()));
+
+    downsample(t, v, 0, LargestTriangle, outT, outV);
+    CHECK(outT.size() == t.size());
+}
+
+TEST_CASE("SpscRing hands items from one thread to another in order") {
+    SpscRing<long> ring(1000);
+    CHECK(ring.capacity() == 1024);
+
+    const long count = 1000000;
+    long sum = 0, expected = 0;
+    bool ordered = true;
+    std::thread consumer([&]() {
+        long item;
+        for (long received = 0; received < count;) {
+            if (ring.pop(item)) {
+                ordered = ordered && item == received;
+                sum += item;
+                ++received;
+            }
+        }
+    });
+    for (long i = 0; i < count; ++i) {
+        while (!ring.push(i)) {
+        }
+        expected += i;
+    }
+    consumer.join();
+
+    CHECK(ordered);
+    CHECK(sum == expected);
+    long item;
+    CHECK_FALSE(ring.pop(item));
+}
+
+TEST_CASE("Live plotter decimates, counts dropped samples and drains the ring in its last frame") {
+    // keeps the last frame; with gated set, the first draw blocks until opened
+    struct RecordingSink : LivePlotSink {
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool gated, drawing;
+        size_t draws;
+        std::vector<double> tx, x;
+
+        RecordingSink(bool gated) : gated(gated), drawing(false), draws(0) {}
+
+        void draw(const std::vector<double>& t, const std::vector<double>& v, const std::vector<double>&,
+                  const std::vector<double>&) {
+            std::unique_lock<std::mutex> lock(mutex);
+            tx = t;
+            x = v;
+            ++draws;
+            drawing = true;
+            changed.notify_all();
+            while (gated) {
+                changed.wait(lock);
+            }
+            drawing = false;
+        }
+
+        bool waitForDraw() {
+            std::unique_lock<std::mutex> lock(mutex);
+            return changed.wait_for(lock, std::chrono::seconds(10), [this]() { return drawing; });
+        }
+
+        void open() {
+            std::lock_guard<std::mutex> lock(mutex);
+            gated = false;
+            changed.notify_all();
+        }
+    };
+
+    SUBCASE("every decimation-th sample reaches the final frame") {
+        RecordingSink sink(false);
+        LivePlotter live(10, 20, 100000, &sink);
+        live.start();
+        for (int i = 0; i < 1000; ++i) {
+            live.observe(i, 2.0 * i, 3.0 * i);
+        }
+        live.stop();
+        CHECK(live.getDroppedSamples() == 0);
+        REQUIRE(sink.tx.size() == 100);
+        for (size_t k = 0; k < sink.tx.size(); ++k) {
+            CHECK(sink.tx[k] == 10.0 * k);
+            CHECK(sink.x[k] == 20.0 * k);
+        }
+        CHECK(live.getFrames() == sink.draws);
+    }
+
+    SUBCASE("a full ring drops samples instead of blocking the run") {
+        RecordingSink sink(true);
+        LivePlotter live(1, 20, 100000, &sink, 4);
+        live.start();
+        live.observe(0, 0, 0);
+        live.observe(1, 2, 3);
+        // the plotting thread is now held inside its first draw
+        REQUIRE(sink.waitForDraw());
+        REQUIRE(sink.tx.size() == 2);
+        for (int i = 2; i < 1002; ++i) {
+            live.observe(i, 2.0 * i, 3.0 * i);
+        }
+        CHECK(live.getDroppedSamples() == 996);
+        sink.open();
+        live.stop();
+        // the four samples that fit in the ring follow the first two
+        REQUIRE(sink.tx.size() == 6);
+        CHECK(sink.tx[5] == 5.0);
+        CHECK(live.getFrames() >= 2);
+    }
+}
+
+TEST_CASE("Batch jobs are parsed and run back to back") {
+    Job job;
+    std::string error;
+    REQUIRE(parseJob("A=1.5 time=2 x0=80 out=run.csv integrator=euler", job, error));
+    CHECK(job.A == 1.5);
+    CHECK(job.B == 0.02);
+    CHECK(job.totalTime == 2.0);
+    CHECK(job.x0 == 80.0);
+    CHECK(job.output == "run.csv");
+    CHECK_FALSE(parseJob("A=abc", job, error));
+    CHECK_FALSE(parseJob("integrator=rk4", job, error));
+    CHECK_FALSE(parseJob("E=1", job, error));
+    const char* invalid[] = { "C=0", "B=-0.02", "x0=0", "y0=nan", "A=inf", "D=-1", "deltat=0", "time=-1" };
+    for (int i = 0; i < 8; ++i) {
+        Job rejected;
+        CHECK_FALSE(parseJob(invalid[i], rejected, error));
+    }
+    CHECK(error == "time non deve essere negativo");
+
+    std::istringstream jobs("# default run\ntime=17\n\ntime=3 A=1.5\nbogus\ntime=1 C=0\n");
+    std::ostringstream out, messages;
+    std::streambuf* saved = std::cerr.rdbuf(messages.rdbuf());
+    int failed = runBatch(jobs, out);
+    std::cerr.rdbuf(saved);
+    CHECK(failed == 2);
+    CHECK(messages.str().find("Errore nel job 4 (riga 6): C deve essere un numero positivo") != std::string::npos);
+
+    Simulation reference(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    reference.runSimulation(17.0);
+    std::istringstream lines(out.str());
+    std::string header, first, second;
+    std::getline(lines, header);
+    std::getline(lines, first);
+    std::getline(lines, second);
+    CHECK(header == "job,x,y,H");
+    std::ostringstream expected;
+    expected << "1," << reference.getX() << "," << reference.getY() << "," << reference.getH();
+    CHECK(first == expected.str());
+    CHECK(second.substr(0, 2) == "2,");
+}
+
+TEST_CASE("Tracing records scopes from several threads as Chrome trace events") {
+    trace::start();
+    std::thread worker([]() {
+        Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+        sim.runSimulation(1.0);
+    });
+    {
+        TRACE_SCOPE("main-thread-scope");
+        worker.join();
+    }
+    {
+        TRACE_SCOPE("quote\" back\\slash\ttab");
+    }
+    trace::stop();
+    {
+        TRACE_SCOPE("ignored-while-stopped");
+    }
+
+    const char* filename = "test_trace.json";
+    REQUIRE(trace::writeChromeTrace(filename));
+    std::ifstream file(filename);
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(filename);
+
+    CHECK(json.find("\"traceEvents\"") != std::string::npos);
+    CHECK(json.find("\"name\":\"runSimulation\"") != std::string::npos);
+    CHECK(json.find("\"name\":\"main-thread-scope\"") != std::string::npos);
+    CHECK(json.find("ignored-while-stopped") == std::string::npos);
+    CHECK(json.find("\"tid\":2") != std::string::npos);
+    CHECK(json.find("\"name\":\"quote\\\" back\\\\slash\\u0009tab\"") != std::string::npos);
+}
+
+TEST_CASE("Chrome trace can be written while other threads record") {
+    trace::start();
+    std::atomic<bool> running(true);
+    std::thread worker([&running]() {
+        for (int i = 0; i < 200000; ++i) {
+            TRACE_SCOPE("busy");
+        }
+        running.store(false);
+    });
+    const char* filename = "test_trace_live.json";
+    bool written = true;
+    for (int i = 0; i < 5 && running.load(); ++i) {
+        written = trace::writeChromeTrace(filename) && written;
+        std::this_thread::yield();
+    }
+    worker.join();
+    trace::stop();
+    written = trace::writeChromeTrace(filename) && written;
+    CHECK(written);
+    std::ifstream file(filename);
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(filename);
+    CHECK(json.find("\"name\":\"busy\"") != std::string::npos);
+    CHECK(json.substr(json.size() - 4) == "\n]}\n");
+}
+
+TEST_CASE("Simulations in a monotonic arena reuse its memory across batches") {
+    Simulation heap(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    heap.runSimulation(17.0);
+
+    MonotonicArena arena(1 << 16);
+    size_t reserved = 0;
+    for (int batch = 0; batch < 3; ++batch) {
+        {
+            Simulation a(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001, &arena);
+            Simulation b(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001, &arena);
+            a.runSimulation(17.0);
+            b.runSimulation(17.0);
+            CHECK(a.getXView().back() == heap.getXValues().back());
+            CHECK(b.getHView().size() == heap.getHValues().size());
+            CHECK_THROWS_AS(a.getXValues(), std::logic_error);
+            CHECK(arena.bytesInUse() >= 2 * 4 * 17001 * sizeof(double));
+        }
+        if (batch == 0) {
+            reserved = arena.bytesReserved();
+        }
+        CHECK(arena.bytesReserved() == reserved);
+        arena.reset();
+        CHECK(arena.bytesInUse() == 0);
+    }
+}
+
+TEST_CASE("Huge-page storage holds the same trajectory as the heap") {
+    HugePageResource hugePages;
+    Simulation heap(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    Simulation huge(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001, &hugePages);
+    // the first sample of each series is under 2 MB and comes from the heap
+    CHECK(hugePages.getSmallAllocations() == 4);
+    CHECK(hugePages.getHugeTlbAllocations() + hugePages.getTransparentAllocations() +
+          hugePages.getFallbackAllocations() == 0);
+    heap.runSimulation(300.0);
+    huge.runSimulation(300.0);
+
+    TrajectoryView hugeX = huge.getXView();
+    CHECK(std::vector<double>(hugeX.begin(), hugeX.end()) == heap.getXValues());
+    CHECK(heap.getXView().data() == heap.getXValues().data());
+    CHECK(huge.getHAtTime(280.5) == heap.getHAtTime(280.5));
+    CHECK(hugePages.getHugeTlbAllocations() + hugePages.getTransparentAllocations() +
+          hugePages.getFallbackAllocations() >= 4);
+}
+
+TEST_CASE("Engine instantiations agree with Simulation to their precision") {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    sim.runSimulation(17.0);
+
+    EngineResult<double> d = runEngine(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001, 17000);
+    CHECK(d.x == sim.getX());
+    CHECK(d.H == sim.getH());
+    CHECK(d.maxDrift >= std::fabs(d.H - d.H0));
+
+    EngineResult<long double> ld = runEngine(1200.0L, 1000.0L, 2.0L, 0.02L, 0.01L, 1.0L, 0.001L, 17000);
+    CHECK(static_cast<double>(ld.x) == doctest::Approx(sim.getX()).epsilon(1e-9));
+
+    EngineResult<float> f = runEngine(1200.0f, 1000.0f, 2.0f, 0.02f, 0.01f, 1.0f, 0.001f, 17000);
+    CHECK(static_cast<double>(f.x) == doctest::Approx(sim.getX()).epsilon(0.05));
+
+#ifdef SIM_HAVE_FLOAT128
+    for (double v = 1e-6; v < 1e6; v *= 7.3) {
+        CHECK(static_cast<double>(scalarLog(static_cast<__float128>(v))) == doctest::Approx(std::log(v)).epsilon(1e-15));
+    }
+    EngineResult<__float128> q = runEngine<__float128>(1200, 1000, 2, __float128(0.02), __float128(0.01), 1,
+                                                       __float128(0.001), 17000);
+    CHECK(static_cast<double>(q.x) == doctest::Approx(static_cast<double>(ld.x)).epsilon(1e-12));
+#endif
+}
+
+TEST_CASE("Mixed-precision ensemble keeps H within a bound of the double run") {
+    std::vector<EnsembleMember> members;
+    for (int i = 0; i < 100; ++i) {
+        EnsembleMember m = { 1200.0, 1000.0, 1.5 + 0.01 * i, 0.02, 0.01, 1.0 };
+        members.push_back(m);
+    }
+    Ensemble reference(members, 0.001, EnsembleDouble);
+    Ensemble mixed(members, 0.001, EnsembleMixed);
+    Ensemble single(members, 0.001, EnsembleFloat);
+    reference.run(20000);
+    mixed.run(15000);
+    mixed.run(5000);
+    single.run(20000);
+    CHECK(mixed.getSteps() == 20000);
+
+    Simulation sim(1200.0, 1000.0, 1.5, 0.02, 0.01, 1.0, 0.001);
+    sim.runSimulation(20.0);
+    CHECK(reference.getX(0) == doctest::Approx(sim.getX()).epsilon(1e-12));
+    CHECK(reference.getH(0) == doctest::Approx(sim.getH()).epsilon(1e-12));
+
+    double mixedError = 0, floatError = 0;
+    for (size_t i = 0; i < members.size(); ++i) {
+        double drift = std::fabs(reference.getH(i) - reference.getInitialH(i));
+        mixedError = std::max(mixedError, std::fabs(mixed.getH(i) - reference.getH(i)) / drift);
+        floatError = std::max(floatError, std::fabs(single.getH(i) - reference.getH(i)) / drift);
+    }
+    // the Euler drift itself is the scale: mixed precision must not add to it
+    CHECK(mixedError < 1e-4);
+    CHECK(mixedError < floatError);
+}
+
+TEST_CASE("Mixed-precision ensemble clamps like the double run") {
+    // y0 is a thousand times its equilibrium, so prey crash to the floor in
+    // the first step and stay clamped for many chunks
+    std::vector<EnsembleMember> members;
+    for (int i = 0; i < 8; ++i) {
+        EnsembleMember m = { 1200.0, 100000.0 * (1 + 0.1 * i), 2.0, 0.02, 0.01, 1.0 };
+        members.push_back(m);
+    }
+    EnsembleMember calm = { 1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0 };
+    members.push_back(calm);
+    Ensemble reference(members, 0.001, EnsembleDouble);
+    Ensemble mixed(members, 0.001, EnsembleMixed);
+    reference.run(3000);
+    mixed.run(3000);
+    for (size_t i = 0; i < members.size(); ++i) {
+        CHECK(mixed.getX(i) > 0);
+        CHECK(mixed.getX(i) == doctest::Approx(reference.getX(i)).epsilon(1e-4));
+        CHECK(mixed.getY(i) == doctest::Approx(reference.getY(i)).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("Compressed trajectory is lossless, indexable and survives a file round trip") {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    sim.runSimulation(17.0);
+    CompressedTrajectory compressed(sim);
+    REQUIRE(compressed.size() == sim.getXValues().size());
+    CHECK(compressed.compressedBytes() * 4 < 3 * sizeof(double) * compressed.size());
+
+    std::vector<double> x;
+    compressed.getXSeries().decode(x);
+    CHECK(std::equal(x.begin(), x.end(), sim.getXValues().begin()));
+    for (double t = 0; t < 17.0; t += 0.37) {
+        CHECK(compressed.getXAtTime(t) == sim.getXAtTime(t));
+        CHECK(compressed.getYAtTime(t) == sim.getYAtTime(t));
+        CHECK(compressed.getHAtTime(t) == sim.getHAtTime(t));
+    }
+    CHECK(compressed.getXAtTime(-1.0) == -1);
+    CHECK(compressed.getXAtTime(100.0) == -1);
+
+    const char* filename = "test_compressed.lvz";
+    REQUIRE(compressed.save(filename));
+    CompressedTrajectory loaded;
+    REQUIRE(loaded.load(filename));
+    std::remove(filename);
+    CHECK(loaded.size() == compressed.size());
+    CHECK(loaded.getDeltat() == compressed.getDeltat());
+    CHECK(loaded.getHAtTime(12.345) == sim.getHAtTime(12.345));
+
+    // a series read back keeps encoding where it stopped
+    std::stringstream buffer;
+    CompressedSeries first, whole;
+    for (size_t i = 0; i < 1500; ++i) {
+        first.append(sim.getYValues()[i]);
+    }
+    first.write(buffer);
+    CompressedSeries resumed;
+    REQUIRE(resumed.read(buffer));
+    for (size_t i = 0; i < 3000; ++i) {
+        if (i >= 1500) {
+            resumed.append(sim.getYValues()[i]);
+        }
+        whole.append(sim.getYValues()[i]);
+    }
+    CHECK(resumed.compressedBytes() == whole.compressedBytes());
+    CHECK(resumed.at(2999) == sim.getYValues()[2999]);
+}
+
+// a copy of a CompressedSeries file with one 64-bit field replaced: count,
+// bits, blocks and words come first, then the block offsets
+static std::string patchField(std::string bytes, size_t field, uint64_t value) {
+    std::memcpy(&bytes[8 * field], &value, sizeof(value));
+    return bytes;
+}
+
+TEST_CASE("Compressed series reject files whose counts or block offsets disagree") {
+    CompressedSeries series;
+    for (int i = 0; i < 1500; ++i) {
+        series.append(1000.0 + std::sin(0.01 * i));
+    }
+    std::ostringstream out;
+    series.write(out);
+    const std::string good = out.str();
+    uint64_t bits;
+    std::memcpy(&bits, &good[8], sizeof(bits));
+
+    CompressedSeries loaded;
+    std::istringstream truncated(good.substr(0, good.size() - 8));
+    CHECK_FALSE(loaded.read(truncated));
+
+    std::istringstream blocks(patchField(good, 2, 3));
+    CHECK_THROWS_AS(loaded.read(blocks), std::runtime_error);
+    std::istringstream words(patchField(good, 3, 1));
+    CHECK_THROWS_AS(loaded.read(words), std::runtime_error);
+    std::istringstream first(patchField(good, 4, 8));
+    CHECK_THROWS_AS(loaded.read(first), std::runtime_error);
+    std::istringstream pastEnd(patchField(good, 5, bits + 1));
+    CHECK_THROWS_AS(loaded.read(pastEnd), std::runtime_error);
+    std::istringstream tooShort(patchField(good, 5, 100));
+    CHECK_THROWS_AS(loaded.read(tooShort), std::runtime_error);
+    CHECK(loaded.size() == 0);
+
+    std::istringstream intact(good);
+    REQUIRE(loaded.read(intact));
+    CHECK(loaded.at(1499) == 1000.0 + std::sin(0.01 * 1499));
+}
+
+TEST_CASE("Lossy encoder keeps every value within the tolerance") {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    LossyTrajectoryEncoder encoder(sim, 1e-3);
+    sim.addObserver(&encoder);
+    sim.runSimulation(17.0);
+
+    const LossyTrajectory& lossy = encoder.getTrajectory();
+    REQUIRE(lossy.size() == sim.getXValues().size());
+    CHECK(lossy.compressedBytes() * 50 < 3 * sizeof(double) * lossy.size());
+
+    std::vector<double> x, y, H;
+    lossy.getXSeries().decode(x);
+    lossy.getYSeries().decode(y);
+    lossy.getHSeries().decode(H);
+    double worst = 0;
+    for (size_t i = 0; i < x.size(); ++i) {
+        worst = std::max(worst, std::fabs(x[i] - sim.getXValues()[i]));
+        worst = std::max(worst, std::fabs(y[i] - sim.getYValues()[i]));
+        worst = std::max(worst, std::fabs(H[i] - sim.getHValues()[i]));
+    }
+    CHECK(worst < 1e-3);
+
+    const char* filename = "test_lossy.lvq";
+    REQUIRE(lossy.save(filename));
+    LossyTrajectory loaded;
+    REQUIRE(loaded.load(filename));
+    std::remove(filename);
+    std::vector<double> y2;
+    loaded.getYSeries().decode(y2);
+    CHECK(loaded.getTolerance() == 1e-3);
+    CHECK(y2 == y);
+
+    const char* csv = "test_lossy.csv";
+    loaded.saveResults(csv);
+    std::ifstream file(csv);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(file, line)) {
+        ++lines;
+    }
+    std::remove(csv);
+    CHECK(lines == sim.getXValues().size() + 1);
+}
+
+TEST_CASE("Lossy series reject tolerances and values they cannot grid") {
+    CHECK_THROWS_AS(LossySeries(0), std::invalid_argument);
+    CHECK_THROWS_AS(LossySeries(-1e-3), std::invalid_argument);
+    CHECK_THROWS_AS(LossySeries(std::nan("")), std::invalid_argument);
+    CHECK_THROWS_AS(LossyTrajectory(HUGE_VAL, 0, 0.001), std::invalid_argument);
+
+    LossySeries series(1e-3);
+    series.append(1.0);
+    CHECK_THROWS_AS(series.append(std::nan("")), std::out_of_range);
+    CHECK_THROWS_AS(series.append(-HUGE_VAL), std::out_of_range);
+    CHECK_THROWS_AS(series.append(1e300), std::out_of_range);
+    series.append(2.5e9);
+    CHECK(series.size() == 2);
+    std::vector<double> decoded;
+    series.decode(decoded);
+    CHECK(std::fabs(decoded[1] - 2.5e9) < 1e-3);
+}
+
+TEST_CASE("Observers see the initial sample once, even after runs without steps") {
+    struct Recorder : SimulationObserver {
+        std::vector<double> times;
+        void observe(double t, double, double) { times.push_back(t); }
+    };
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    Recorder recorder;
+    sim.addObserver(&recorder);
+    sim.runSimulation(0.0);
+    sim.runSimulation(0.0);
+    sim.runSimulation(0.0105);
+    REQUIRE(recorder.times.size() == sim.getTimeValues().size());
+    CHECK(std::count(recorder.times.begin(), recorder.times.end(), 0.0) == 1);
+    CHECK(recorder.times.back() == sim.getTimeValues().back());
+
+    // reset starts a new trajectory, whose t = 0 is sent again
+    sim.reset(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    recorder.times.clear();
+    sim.runSimulation(0.0055);
+    CHECK(recorder.times.size() == 6);
+    CHECK(recorder.times[0] == 0.0);
+}
+
+TEST_CASE("Asynchronous writer produces the saveResults file while the run goes") {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    // small buffers so the run hands off many times
+    AsyncWriter csv(sim, "test_async.csv", OutputCsv, 1000);
+    AsyncWriter binary(sim, "test_async.bin", OutputBinary, 1000);
+    REQUIRE(csv.isOpen());
+    REQUIRE(binary.isOpen());
+    sim.addObserver(&csv);
+    sim.addObserver(&binary);
+    sim.runSimulation(17.0);
+    csv.close();
+    binary.close();
+    sim.saveResults("test_sync.csv");
+
+    std::ifstream a("test_async.csv"), b("test_sync.csv");
+    std::stringstream asyncText, syncText;
+    asyncText << a.rdbuf();
+    syncText << b.rdbuf();
+    CHECK(asyncText.str() == syncText.str());
+    CHECK(csv.getBytesWritten() == syncText.str().size());
+
+    std::ifstream raw("test_async.bin", std::ios::binary);
+    std::vector<double> records(4 * sim.getXValues().size());
+    raw.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(double));
+    CHECK(raw.gcount() == static_cast<std::streamsize>(binary.getBytesWritten()));
+    CHECK(records[4 * 1234] == sim.getTimeValues()[1234]);
+    CHECK(records[4 * 1234 + 1] == sim.getXValues()[1234]);
+    CHECK(records[4 * 1234 + 3] == sim.getHValues()[1234]);
+    CHECK(records[records.size() - 2] == sim.getYValues().back());
+
+    std::remove("test_async.csv");
+    std::remove("test_async.bin");
+    std::remove("test_sync.csv");
+}
+
+TEST_CASE("Asynchronous writer computes H without the simulation") {
+    Simulation* sim = new Simulation(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    AsyncWriter csv(*sim, "test_async.csv", OutputCsv, 1 << 20);
+    sim->addObserver(&csv);
+    sim->runSimulation(3.0);
+    sim->saveResults("test_sync.csv");
+    // the whole run is still buffered when the simulation goes away
+    delete sim;
+    csv.close();
+
+    std::ifstream a("test_async.csv"), b("test_sync.csv");
+    std::stringstream asyncText, syncText;
+    asyncText << a.rdbuf();
+    syncText << b.rdbuf();
+    CHECK(asyncText.str() == syncText.str());
+    std::remove("test_async.csv");
+    std::remove("test_sync.csv");
+}
+
+TEST_CASE("Sweep writer stores files from several threads on every backend") {
+    std::vector<std::string> contents;
+    for (int i = 0; i < 40; ++i) {
+        std::ostringstream text;
+        for (int line = 0; line < i * 300; ++line) {
+            text << i << "," << line * 0.001 << "\n";
+        }
+        contents.push_back(text.str());
+    }
+
+    WriterBackend backends[] = { WriterPwrite, WriterIoUring, WriterIoUring };
+    for (int b = 0; b < 3; ++b) {
+        bool direct = b == 2;
+        // small buffers and queue so large files span several writes and threads wait for buffers
+        SweepWriter writer(backends[b], 8, 8192, direct);
+        std::vector<std::thread> workers;
+        for (int w = 0; w < 4; ++w) {
+            workers.push_back(std::thread([&writer, &contents, w]() {
+                for (size_t i = w; i < contents.size(); i += 4) {
+                    std::ostringstream name;
+                    name << "test_sweep_" << i << ".csv";
+                    writer.writeFile(name.str(), contents[i]);
+                }
+            }));
+        }
+        for (size_t w = 0; w < workers.size(); ++w) {
+            workers[w].join();
+        }
+        writer.flush();
+        CHECK(writer.getFiles() == contents.size());
+        CHECK(writer.getErrors() == 0);
+
+        for (size_t i = 0; i < contents.size(); ++i) {
+            std::ostringstream name;
+            name << "test_sweep_" << i << ".csv";
+            std::ifstream file(name.str().c_str(), std::ios::binary);
+            std::stringstream text;
+            text << file.rdbuf();
+            CHECK(text.str() == contents[i]);
+            std::remove(name.str().c_str());
+        }
+        if (writer.getBackend() == WriterIoUring) {
+            // batching: fewer kernel entries than buffer-sized writes
+            size_t chunks = 0;
+            for (size_t i = 0; i < contents.size(); ++i) {
+                chunks += (contents[i].size() + 8191) / 8192;
+            }
+            CHECK(writer.getSyscalls() < chunks);
+        }
+    }
+}
+
+TEST_CASE("Sweep writer reports failed writes") {
+    // /dev/full opens for writing and fails every write with ENOSPC
+    SweepWriter writer(WriterPwrite);
+    CHECK_FALSE(writer.writeFile("/dev/full", "time,x,y,H\n"));
+    CHECK(writer.getErrors() == 1);
+    CHECK_FALSE(writer.writeFile("no_such_directory/out.csv", "time,x,y,H\n"));
+
+    // io_uring only when asked for
+    SweepWriter standard;
+    CHECK(standard.getBackend() == WriterPwrite);
+}
+
+TEST_CASE("Model layer: Lotka-Volterra matches Simulation, Holling models settle with falling V") {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    sim.runSimulation(17.0);
+    ModelSimulation<LotkaVolterraModel<double> > lv(LotkaVolterraModel<double>(2.0, 0.02, 0.01, 1.0), 1200.0,
+                                                    1000.0, 0.001);
+    lv.run(17000);
+    CHECK(lv.getX() == doctest::Approx(sim.getX()).epsilon(1e-12));
+    CHECK(lv.getInvariant() == doctest::Approx(sim.getH()).epsilon(1e-12));
+
+    // K below 2 x* + 1 / (a h): stable equilibrium, V is a Lyapunov function
+    RosenzweigMacArthur<double> rm(1.0, 100.0, 0.02, 0.5, 0.5, 0.2);
+    CHECK(rm.e * rm.f(rm.xStar) == doctest::Approx(rm.m));
+    ModelSimulation<RosenzweigMacArthur<double> > typeII(rm, 50.0, 20.0, 0.001);
+
+    PredatorPreyModel<double, HollingTypeIII> h3(1.0, 100.0, HollingTypeIII<double>(0.001, 0.5), 0.5, 0.2);
+    ModelSimulation<PredatorPreyModel<double, HollingTypeIII> > typeIII(h3, 50.0, 20.0, 0.001);
+
+    double v2 = typeII.getInvariant(), v3 = typeIII.getInvariant();
+    double start2 = v2, start3 = v3, rise2 = 0, rise3 = 0;
+    for (int i = 0; i < 100000; ++i) {
+        typeII.evolve();
+        typeIII.evolve();
+        rise2 = std::max(rise2, typeII.getInvariant() - v2);
+        rise3 = std::max(rise3, typeIII.getInvariant() - v3);
+        v2 = typeII.getInvariant();
+        v3 = typeIII.getInvariant();
+    }
+    // Euler steps may raise V by O(deltat^2) only
+    CHECK(rise2 < 1e-5 * start2);
+    CHECK(rise3 < 1e-5 * start3);
+    CHECK(v2 < 1e-3 * start2);
+    CHECK(v3 < 1e-3 * start3);
+    CHECK(typeIII.getX() == doctest::Approx(h3.xStar).epsilon(1e-3));
+    CHECK(typeIII.getY() == doctest::Approx(h3.yStar).epsilon(1e-3));
+}
+
+TEST_CASE("Seasonal forcing tables drive A and D without trig in the step loop") {
+    const double deltat = 0.001, pi = 3.14159265358979323846;
+    ForcingTable A = ForcingTable::seasonal(2.0, 0.3, 5.0, 0.0, deltat);
+    ForcingTable D = ForcingTable::seasonal(1.0, 0.2, 5.0, pi / 2, deltat);
+    CHECK(A.size() == 5000);
+    CHECK(A.getPeriod() == doctest::Approx(5.0));
+    CHECK(A[0] == doctest::Approx(2.6));
+    CHECK(A[2500] == doctest::Approx(1.4));
+    CHECK(A.at(7500) == A[2500]);
+    CHECK(D[0] == doctest::Approx(1.0));
+
+    // the table-driven model against cos evaluated at every step
+    ModelSimulation<SeasonalLotkaVolterra<double> > forced(SeasonalLotkaVolterra<double>(A, 0.02, 0.01, D), 1200.0,
+                                                          1000.0, deltat);
+    double x = 1200.0, y = 1000.0;
+    for (long k = 0; k < 17000; ++k) {
+        double t = k * deltat;
+        double a = 2.0 * (1 + 0.3 * std::cos(2 * pi * t / 5.0));
+        double d = 1.0 * (1 + 0.2 * std::cos(2 * pi * t / 5.0 + pi / 2));
+        double nx = x + (a - 0.02 * y) * x * deltat;
+        double ny = y + (0.01 * x - d) * y * deltat;
+        x = nx > 0 ? nx : 1e-6 * d / 0.01;
+        y = ny > 0 ? ny : 1e-6 * a / 0.02;
+        forced.evolve();
+    }
+    CHECK(forced.getX() == doctest::Approx(x).epsilon(1e-9));
+    CHECK(forced.getY() == doctest::Approx(y).epsilon(1e-9));
+
+    // constant tables reduce to the plain model; the model keeps its own copy
+    // of the temporary tables
+    ModelSimulation<SeasonalLotkaVolterra<double> > flat(
+        SeasonalLotkaVolterra<double>(ForcingTable::constant(2.0, deltat), 0.02, 0.01, ForcingTable::constant(1.0, deltat)),
+        1200.0, 1000.0, deltat);
+    ModelSimulation<LotkaVolterraModel<double> > plain(LotkaVolterraModel<double>(2.0, 0.02, 0.01, 1.0), 1200.0,
+                                                       1000.0, deltat);
+    flat.run(17000);
+    plain.run(17000);
+    CHECK(flat.getX() == plain.getX());
+    CHECK(flat.getInvariant() == plain.getInvariant());
+}
+
+TEST_CASE("Model simulation clamps at Simulation's relative floor") {
+    // a step this long overshoots zero many times
+    const double deltat = 0.1;
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, deltat);
+    sim.runSimulation(30.0);
+    ModelSimulation<LotkaVolterraModel<double> > model(LotkaVolterraModel<double>(2.0, 0.02, 0.01, 1.0), 1200.0,
+                                                       1000.0, deltat);
+    // 1e-6 of the equilibrium (100, 100)
+    const double floor = 1e-4;
+    size_t clamped = 0;
+    bool close = true;
+    for (size_t i = 1; i < sim.getXValues().size(); ++i) {
+        model.evolve();
+        double x = sim.getXValues()[i], y = sim.getYValues()[i];
+        clamped += (std::fabs(x - floor) < 1e-15) + (std::fabs(y - floor) < 1e-15);
+        close = close && std::fabs(model.getX() - x) <= 1e-9 * x && std::fabs(model.getY() - y) <= 1e-9 * y;
+    }
+    CHECK(clamped > 0);
+    CHECK(close);
+}
+
+TEST_CASE("Delay solver keeps the lagged history in a ring buffer") {
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001);
+    sim.runSimulation(17.0);
+    DelaySimulation instant(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, 0.001, 0.0);
+    instant.runSimulation(17.0);
+    CHECK(instant.getX() == doctest::Approx(sim.getX()).epsilon(1e-12));
+    CHECK(instant.getY() == doctest::Approx(sim.getY()).epsilon(1e-12));
+
+    // a delay of 500 steps against Euler over the whole stored history
+    const double deltat = 0.001;
+    const size_t lag = 500;
+    std::vector<double> xs(1, 1200.0), ys(1, 1000.0);
+    for (size_t n = 0; n < 17000; ++n) {
+        double xl = n >= lag ? xs[n - lag] : 1200.0, yl = n >= lag ? ys[n - lag] : 1000.0;
+        double nx = xs[n] + (2.0 - 0.02 * ys[n]) * xs[n] * deltat;
+        double ny = ys[n] + (0.01 * xl * yl - ys[n]) * deltat;
+        xs.push_back(nx > 0 ? nx : 1e-4);
+        ys.push_back(ny > 0 ? ny : 1e-4);
+    }
+    DelaySimulation delayed(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, deltat, lag * deltat);
+    delayed.runSimulation(17.0);
+    CHECK(delayed.getX() == xs.back());
+    CHECK(delayed.getY() == ys.back());
+    CHECK(delayed.getHistory().capacity() >= lag + 2);
+    CHECK((delayed.getHistory().capacity() & (delayed.getHistory().capacity() - 1)) == 0);
+
+    // lags between samples are interpolated, exactly so on a linear history
+    DelayHistory history(0.01, deltat, 0.0, 0.0);
+    for (int k = 1; k <= 40; ++k) {
+        history.push(k, 2.0 * k);
+    }
+    double x, y;
+    history.lagged(Lag(0.0042, deltat), x, y);
+    CHECK(x == doctest::Approx(35.8));
+    CHECK(y == doctest::Approx(71.6));
+    history.lagged(Lag(0.003, deltat), x, y);
+    CHECK(x == 37.0);
+
+    // observers see t = 0 once, even after a run without steps
+    struct Recorder : SimulationObserver {
+        std::vector<double> times;
+        void observe(double t, double, double) { times.push_back(t); }
+    };
+    Recorder recorder;
+    DelaySimulation observed(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, deltat, lag * deltat);
+    observed.addObserver(&recorder);
+    observed.runSimulation(0.0);
+    observed.runSimulation(0.0105);
+    CHECK(recorder.times.size() == 11);
+    CHECK(std::count(recorder.times.begin(), recorder.times.end(), 0.0) == 1);
+}
+
+TEST_CASE("SDE ensemble: Philox normals, Milstein order and thread-independent paths") {
+    // known answers of Philox4x32-10 (Random123)
+    uint32_t zero[4] = { 0, 0, 0, 0 };
+    philox4x32(zero, 0, 0);
+    CHECK(zero[0] == 0x6627e8d5u);
+    CHECK(zero[3] == 0x9b00dbd8u);
+    uint32_t ones[4] = { 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu };
+    philox4x32(ones, 0xffffffffu, 0xffffffffu);
+    CHECK(ones[0] == 0x408f276du);
+    CHECK(ones[3] == 0x6d5451fdu);
+
+    const size_t n = 50000;
+    std::vector<double> z0(n), z1(n), z2(n), z3(n);
+    philoxNormals(7, 3, 0, n, z0.data(), z1.data(), z2.data(), z3.data());
+    double mean = 0, var = 0, cross = 0;
+    size_t tails = 0;
+    for (size_t i = 0; i < n; ++i) {
+        mean += z0[i] + z1[i] + z2[i] + z3[i];
+        var += z0[i] * z0[i] + z1[i] * z1[i] + z2[i] * z2[i] + z3[i] * z3[i];
+        cross += z0[i] * z2[i] + z1[i] * z3[i];
+        tails += (std::fabs(z0[i]) > 2) + (std::fabs(z1[i]) > 2) + (std::fabs(z2[i]) > 2) + (std::fabs(z3[i]) > 2);
+    }
+    CHECK(std::fabs(mean / (4 * n)) < 0.01);
+    CHECK(std::fabs(var / (4 * n) - 1) < 0.01);
+    CHECK(std::fabs(cross / (2 * n)) < 0.01);
+    // P(|z| > 2) = 0.0455
+    CHECK(std::fabs(tails / (4.0 * n) - 0.0455) < 0.003);
+    double a, b, c, d;
+    philoxNormals(7, 3, 4242, 1, &a, &b, &c, &d);
+    CHECK(a == z0[4242]);
+    CHECK(b == z1[4242]);
+    CHECK(c == z2[4242]);
+    CHECK(d == z3[4242]);
+
+    // prey without predators is geometric Brownian motion, whose exact value
+    // follows from the same increments
+    const double deltat = 0.001, sigma = 0.5;
+    std::vector<EnsembleMember> prey(64);
+    for (size_t i = 0; i < prey.size(); ++i) {
+        EnsembleMember m = { 100.0, 0.0, 1.0, 0.0, 0.0, 1.0 };
+        prey[i] = m;
+    }
+    StochasticEnsemble em(prey, deltat, sigma, 0.0, EulerMaruyama), milstein(prey, deltat, sigma, 0.0, Milstein);
+    em.run(1000);
+    milstein.run(1000);
+    double emError = 0, milsteinError = 0;
+    for (size_t i = 0; i < prey.size(); ++i) {
+        double w = 0;
+        for (long s = 0; s < 1000; ++s) {
+            milstein.noise(i, s, a, b);
+            w += std::sqrt(deltat) * a;
+        }
+        double exact = 100.0 * std::exp(1.0 - sigma * sigma / 2 + sigma * w);
+        emError += std::fabs(em.getX(i) - exact) / exact;
+        milsteinError += std::fabs(milstein.getX(i) - exact) / exact;
+    }
+    CHECK(milsteinError / prey.size() < 1e-3);
+    CHECK(milsteinError < emError / 5);
+
+    // paths depend only on (member, step): threads and split runs change nothing
+    std::vector<EnsembleMember> members(1100);
+    for (size_t i = 0; i < members.size(); ++i) {
+        EnsembleMember m = { 1200.0, 1000.0, 1.5 + 0.001 * i, 0.02, 0.01, 1.0 };
+        members[i] = m;
+    }
+    // an odd split starts the second run halfway through a Philox counter
+    StochasticEnsemble once(members, deltat, 0.1, 0.1), split(members, deltat, 0.1, 0.1);
+    once.run(300);
+    split.run(121, 3);
+    split.run(100, 2);
+    split.run(79, 3);
+    bool same = true;
+    for (size_t i = 0; i < members.size(); ++i) {
+        same = same && once.getX(i) == split.getX(i) && once.getY(i) == split.getY(i);
+    }
+    CHECK(same);
+    CHECK(split.getSteps() == 300);
+
+    // without noise Euler-Maruyama is Simulation's step
+    StochasticEnsemble quiet(std::vector<EnsembleMember>(1, members[500]), deltat, 0.0, 0.0, EulerMaruyama);
+    quiet.run(17000);
+    Simulation sim(1200.0, 1000.0, 2.0, 0.02, 0.01, 1.0, deltat);
+    sim.runSimulation(17.0);
+    CHECK(quiet.getX(0) == doctest::Approx(sim.getX()).epsilon(1e-9));
+    CHECK(quiet.getY(0) == doctest::Approx(sim.getY()).epsilon(1e-9));
+}